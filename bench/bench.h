@@ -0,0 +1,106 @@
+#ifndef LM_TMX_BENCH_H
+#define LM_TMX_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Timing helpers shared by the benchmarks. Every benchmark is a standalone
+ * program built against the library's sources, see README.md.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_BENCH_REPS 5 //@- Runs of each measurement, the fastest is kept.
+
+namespace bench {
+    //@- Results are folded in here so the work can't be optimized away.
+    static volatile uint64_t sink;
+
+    /**
+     * Times a function.
+     *
+     * @param p_fn Function to time.
+     * @param p_reps Number of runs. Defaults to TMX_BENCH_REPS.
+     * @returns [double] Seconds taken by the fastest run.
+     */
+    template<class F>
+    double best(F p_fn, unsigned int p_reps = TMX_BENCH_REPS) {
+        double t = 1e30;
+        for (unsigned int i = 0; i < p_reps; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            p_fn();
+            const std::chrono::duration<double> d =
+                std::chrono::steady_clock::now() - start;
+            if (d.count() < t)
+                t = d.count();
+        }
+        return t;
+    }
+
+    /**
+     * Prints a measurement.
+     *
+     * @param p_name What was measured.
+     * @param p_sec Seconds taken.
+     * @param p_items Items processed in that time.
+     * @param p_unit Name of the items.
+     */
+    inline void report(const char* p_name, double p_sec, double p_items,
+                       const char* p_unit) {
+        const double rate = p_items / p_sec;
+        if (rate >= 1e6)
+            printf("%-36s %10.3f ms %10.1f M%s/s\n", p_name, p_sec * 1e3,
+                   rate / 1e6, p_unit);
+        else
+            printf("%-36s %10.3f ms %10.1f K%s/s\n", p_name, p_sec * 1e3,
+                   rate / 1e3, p_unit);
+    }
+
+    /**
+     * Builds an empty map node of 16x16 pixel tiles.
+     *
+     * @param p_width Width of the map in tiles.
+     * @param p_height Height of the map in tiles.
+     * @returns [tmx::sNode] The <map> node.
+     */
+    inline tmx::sNode mkMap(unsigned int p_width, unsigned int p_height) {
+        const char* names[] = { "width", "height", "tilewidth", "tileheight" };
+        const std::string values[] = {
+            std::to_string(p_width), std::to_string(p_height), "16", "16"
+        };
+
+        tmx::sNode map = tmx::mkNode(tmx::eTag::map);
+        for (unsigned int i = 0; i < 4; i++)
+            tmx::setNodeVar(
+                map, tmx::mkVar(names[i], values[i], tmx::eType::whole)
+            );
+        return map;
+    }
+
+    /**
+     * Adds a layer to a map built by mkMap.
+     *
+     * @param p_map The <map> node.
+     * @param p_name Name of the layer.
+     * @param p_tiles The layer's tiles, owned by the map from now on.
+     * @returns [tmx::sNode*] The <layer> node.
+     */
+    inline tmx::sNode* addLayer(tmx::sNode& p_map, const std::string& p_name,
+                                tmx::tilelayer* p_tiles) {
+        tmx::sNode* layer = tmx::nodeMkNode(p_map, tmx::eTag::layer);
+        tmx::setNodeVar(*layer, tmx::mkVar("name", p_name, tmx::eType::str));
+        tmx::sNode* data = tmx::nodeMkNode(*layer, tmx::eTag::data);
+        data->data = new tmx::sData(tmx::mkData("", tmx::eEnc::csv));
+        data->data->tiles = p_tiles;
+        return layer;
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_collision.h"
+
+/**============================================================================
+ * Collision generation on a large layer: a full build, then the rebuild of
+ * the chunks touched by scattered edits.
+ ============================================================================*/
+
+#define COLLISION_SIZE 4096 //@- Width & height of the layer in tiles.
+#define COLLISION_EDITS 200 //@- Tiles changed between rebuilds.
+
+using namespace tmx;
+
+int main() {
+    const size_t n = (size_t)COLLISION_SIZE * COLLISION_SIZE;
+    std::mt19937 rng(1);
+
+    // Walls of solid tiles (gid 1) in rooms of floor (gid 2).
+    std::vector<uint32_t> gids(n, 2);
+    for (unsigned int y = 0; y < COLLISION_SIZE; y++)
+        for (unsigned int x = 0; x < COLLISION_SIZE; x++)
+            if (x % 24 == 0 || y % 16 == 0 || rng() % 50 == 0)
+                gids[(size_t)y * COLLISION_SIZE + x] = 1;
+
+    sNode map = bench::mkMap(COLLISION_SIZE, COLLISION_SIZE);
+    sNode* ts = nodeMkNode(map, eTag::tileset);
+    setNodeVar(*ts, mkVar("firstgid", "1", eType::whole));
+    setNodeVar(*ts, mkVar("tilecount", "2", eType::whole));
+    setNodeVar(*ts, mkVar("tilewidth", "16", eType::whole));
+    setNodeVar(*ts, mkVar("tileheight", "16", eType::whole));
+    sNode* tile = nodeMkNode(*ts, eTag::tile);
+    setNodeVar(*tile, mkVar("id", "0", eType::whole));
+    setNodeVar(*tile, mkVar("solid", "true", eType::boolean), true);
+
+    tilelayer* layer = new tilelayer(gids.data(), COLLISION_SIZE,
+                                     COLLISION_SIZE);
+    bench::addLayer(map, "walls", layer);
+
+    collider c;
+    double t = bench::best([&]() {
+        c = collider(map, layer);
+        bench::sink += c.update();
+    });
+    bench::report("full build", t, (double)n, "tiles");
+
+    t = bench::best([&]() {
+        for (unsigned int i = 0; i < COLLISION_EDITS; i++)
+            layer->set(rng() % COLLISION_SIZE, rng() % COLLISION_SIZE,
+                       1 + rng() % 2);
+        bench::sink += c.update();
+    });
+    bench::report("rebuild after edits", t, COLLISION_EDITS, "edits");
+    printf("%-36s %10zu\n", "rectangles", c.rects().size());
+
+    freeNode(map);
+    return 0;
+}
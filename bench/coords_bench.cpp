@@ -0,0 +1,76 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_coords.h"
+
+/**============================================================================
+ * Throughput of the batch tile/pixel conversions of each orientation,
+ * against converting the same points one at a time, on 1024x1024 maps.
+ * Both must agree on every point.
+ ============================================================================*/
+
+#define COORDS_POINTS 1000000 //@- Points converted per measurement.
+
+using namespace tmx;
+
+int main() {
+    const char* names[] = { "ortho", "iso", "stag", "hex" };
+    const sMapGeom geoms[] = {
+        { eOrient::ortho, 1024, 1024, 32, 32, 0, false, false },
+        { eOrient::iso, 1024, 1024, 64, 32, 0, false, false },
+        { eOrient::stag, 1024, 1024, 64, 32, 0, false, false },
+        { eOrient::hex, 1024, 1024, 32, 28, 16, true, false }
+    };
+    std::mt19937 rng(1);
+
+    std::vector<int32_t> tiles(COORDS_POINTS * 2);
+    std::vector<float> pixels(COORDS_POINTS * 2);
+    for (size_t i = 0; i < tiles.size(); i++)
+        tiles[i] = rng() % 1024;
+
+    for (unsigned int o = 0; o < 4; o++) {
+        const sMapGeom& g = geoms[o];
+        printf("-- %s\n", names[o]);
+
+        double t = bench::best([&]() {
+            tilesToPixels(g, tiles.data(), COORDS_POINTS, pixels.data());
+            bench::sink += (uint64_t)pixels[0];
+        });
+        bench::report("tilesToPixels", t, COORDS_POINTS, "pts");
+
+        const std::vector<float> batch = pixels;
+        t = bench::best([&]() {
+            for (size_t i = 0; i < COORDS_POINTS; i++)
+                tileToPixel(g, tiles[i * 2], tiles[i * 2 + 1],
+                            pixels[i * 2], pixels[i * 2 + 1]);
+            bench::sink += (uint64_t)pixels[0];
+        });
+        bench::report("tileToPixel, one at a time", t, COORDS_POINTS, "pts");
+        if (pixels != batch)
+            printf("!! tilesToPixels mismatch\n");
+
+        // Pixels anywhere within the map, not only at cell corners.
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = (float)(rng() % 32768) + 0.5f;
+
+        std::vector<int32_t> out(COORDS_POINTS * 2);
+        t = bench::best([&]() {
+            pixelsToTiles(g, pixels.data(), COORDS_POINTS, out.data());
+            bench::sink += out[0];
+        });
+        bench::report("pixelsToTiles", t, COORDS_POINTS, "pts");
+
+        const std::vector<int32_t> tbatch = out;
+        t = bench::best([&]() {
+            for (size_t i = 0; i < COORDS_POINTS; i++)
+                pixelToTile(g, pixels[i * 2], pixels[i * 2 + 1],
+                            out[i * 2], out[i * 2 + 1]);
+            bench::sink += out[0];
+        });
+        bench::report("pixelToTile, one at a time", t, COORDS_POINTS, "pts");
+        if (out != tbatch)
+            printf("!! pixelsToTiles mismatch\n");
+    }
+    return 0;
+}
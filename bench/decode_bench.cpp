@@ -0,0 +1,281 @@
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_decode.h"
+#include "tmx_utils.h"
+
+/**============================================================================
+ * Layer data decoding of a 1024x1024 layer in every encoding & compression:
+ * the specialized 32-bit, 16-bit & split flag decoders against a generic
+ * decoder that switches on the format for every tile.
+ *
+ * Compressed streams are deflated with the fixed Huffman code, literals only,
+ * so both decoders pay the same inflate cost on top of their own.
+ ============================================================================*/
+
+#define DECODE_SIZE 1024 //@- Width & height of the layer in tiles.
+#define DECODE_MAXGID 200 //@- Highest gid of the layer's tileset.
+
+using namespace tmx;
+
+/** @returns [uint32_t] Adler-32 checksum of a buffer. */
+static uint32_t adler32(const std::string& p_data) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < p_data.size(); i++) {
+        a = (a + (uint8_t)p_data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+/** @returns [uint32_t] CRC-32 of a buffer. */
+static uint32_t crc32(const std::string& p_data) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < p_data.size(); i++) {
+        c ^= (uint8_t)p_data[i];
+        for (unsigned int k = 0; k < 8; k++)
+            c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+    }
+    return ~c;
+}
+
+/**
+ * Deflates a buffer as one fixed Huffman block of literals.
+ *
+ * @param p_data The buffer.
+ * @returns [std::string] The raw deflate stream.
+ */
+static std::string deflate(const std::string& p_data) {
+    std::string out;
+    uint32_t acc = 0;
+    unsigned int bits = 0;
+    auto put = [&](uint32_t p_v, unsigned int p_n) {
+        acc |= p_v << bits;
+        for (bits += p_n; bits >= 8; bits -= 8, acc >>= 8)
+            out += (char)(acc & 0xFF);
+    };
+    // Huffman codes go most significant bit first.
+    auto code = [&](uint32_t p_c, unsigned int p_n) {
+        uint32_t r = 0;
+        for (unsigned int i = 0; i < p_n; i++)
+            r |= ((p_c >> i) & 1) << (p_n - 1 - i);
+        put(r, p_n);
+    };
+
+    put(1, 1);
+    put(1, 2);
+    for (size_t i = 0; i < p_data.size(); i++) {
+        const uint8_t b = p_data[i];
+        if (b < 144)
+            code(0x30 + b, 8);
+        else
+            code(0x190 + b - 144, 9);
+    }
+    code(0, 7);
+    if (bits > 0)
+        out += (char)(acc & 0xFF);
+    return out;
+}
+
+/**
+ * Appends a 32-bit value to a buffer.
+ *
+ * @param p_s The buffer.
+ * @param p_v The value.
+ * @param p_big Whether to append it big-endian rather than little-endian.
+ */
+static void put32(std::string& p_s, uint32_t p_v, bool p_big = false) {
+    for (unsigned int i = 0; i < 4; i++)
+        p_s += (char)(p_v >> (p_big ? 24 - 8 * i : 8 * i));
+}
+
+/** @returns [std::string] A buffer encoded in base64. */
+static std::string toBase64(const std::string& p_data) {
+    const char* set =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < p_data.size(); i += 3) {
+        uint32_t w = (uint8_t)p_data[i] << 16;
+        if (i + 1 < p_data.size())
+            w |= (uint8_t)p_data[i + 1] << 8;
+        if (i + 2 < p_data.size())
+            w |= (uint8_t)p_data[i + 2];
+        out += set[w >> 18];
+        out += set[(w >> 12) & 63];
+        out += (i + 1 < p_data.size()) ? set[(w >> 6) & 63] : '=';
+        out += (i + 2 < p_data.size()) ? set[w & 63] : '=';
+    }
+    return out;
+}
+
+/**
+ * Decodes a layer's gids one tile at a time, switching on the format for
+ * each of them.
+ *
+ * @returns [size_t] Number of gids decoded.
+ */
+static size_t generic(eEnc p_enc, eComp p_comp, const sDecodeSrc& p_src,
+                      uint32_t* p_out, size_t p_count) {
+    std::string bytes, inflated;
+    if (p_enc == eEnc::base64) {
+        std::string digits;
+        for (size_t i = 0; i < p_src.len; i++) {
+            const char c = p_src.raw[i];
+            const char* set = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                              "abcdefghijklmnopqrstuvwxyz0123456789+/";
+            const char* at = (c != 0) ? strchr(set, c) : nullptr;
+            if (at != nullptr)
+                digits += (char)(at - set);
+        }
+        for (size_t i = 0; i + 1 < digits.size(); i += 4) {
+            uint32_t w = 0;
+            for (unsigned int k = 0; k < 4; k++)
+                w = (w << 6) | ((i + k < digits.size()) ? digits[i + k] : 0);
+            const size_t n = std::min<size_t>(3, (digits.size() - i) * 6 / 8);
+            for (size_t k = 0; k < n; k++)
+                bytes += (char)(w >> (16 - 8 * k));
+        }
+        if (p_comp != eComp::none) {
+            inflated.resize(p_count * 4);
+            const size_t n = (p_comp == eComp::zlib) ?
+                zlib_decompress(bytes.data(), bytes.size(), &inflated[0],
+                                inflated.size()) :
+                gzip_decompress(bytes.data(), bytes.size(), &inflated[0],
+                                inflated.size());
+            inflated.resize(n);
+            bytes.swap(inflated);
+        }
+    }
+
+    const char* at = p_src.raw;
+    const char* end = p_src.raw + p_src.len;
+    rapidxml::xml_node<>* tile =
+        p_src.node ? p_src.node->first_node("tile") : nullptr;
+    size_t n = 0;
+    for (; n < p_count; n++) {
+        uint32_t gid = 0;
+        switch (p_enc) {
+        case eEnc::csv: {
+            while (at < end && (*at < '0' || *at > '9'))
+                at++;
+            if (at == end)
+                return n;
+            char* next;
+            gid = strtoul(at, &next, 10);
+            at = next;
+            break;
+        }
+        case eEnc::xml: {
+            if (tile == nullptr)
+                return n;
+            rapidxml::xml_attribute<>* a = tile->first_attribute("gid");
+            gid = a ? strtoul(a->value(), nullptr, 10) : 0;
+            tile = tile->next_sibling("tile");
+            break;
+        }
+        case eEnc::base64: {
+            if (4 * n + 4 > bytes.size())
+                return n;
+            const uint8_t* b = (const uint8_t*)bytes.data() + 4 * n;
+            gid = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+            break;
+        }
+        default:
+            return n;
+        }
+        p_out[n] = gid;
+    }
+    return n;
+}
+
+int main() {
+    const size_t n = (size_t)DECODE_SIZE * DECODE_SIZE;
+    std::mt19937 rng(1);
+
+    std::vector<uint32_t> gids(n);
+    for (size_t i = 0; i < n; i++) {
+        gids[i] = (rng() % 4) ? 1 + rng() % DECODE_MAXGID : 0;
+        if (gids[i] != 0 && rng() % 8 == 0)
+            gids[i] |= TMX_FLIP_H;
+    }
+
+    // The layer's data in each format.
+    std::string csv, xml = "<data>", raw;
+    for (size_t i = 0; i < n; i++) {
+        csv += std::to_string(gids[i]) + ((i + 1 < n) ? "," : "");
+        xml += gids[i] ? "<tile gid=\"" + std::to_string(gids[i]) + "\"/>" :
+                         "<tile/>";
+        put32(raw, gids[i]);
+    }
+    xml += "</data>";
+    std::string zs = "\x78\x01" + deflate(raw);
+    put32(zs, adler32(raw), true);
+    std::string gz = std::string("\x1F\x8B\x08\0\0\0\0\0\0\xFF", 10) +
+                     deflate(raw);
+    put32(gz, crc32(raw));
+    put32(gz, (uint32_t)raw.size());
+    const std::string texts[] = {
+        csv, xml, toBase64(raw), toBase64(zs), toBase64(gz)
+    };
+    const char* names[] = { "csv", "xml", "base64", "base64 zlib",
+                            "base64 gzip" };
+    const eEnc encs[] = { eEnc::csv, eEnc::xml, eEnc::base64, eEnc::base64,
+                          eEnc::base64 };
+    const eComp comps[] = { eComp::none, eComp::none, eComp::none,
+                            eComp::zlib, eComp::gzip };
+
+    rapidxml::xml_document<> doc;
+    std::vector<char> xmlbuf(xml.begin(), xml.end());
+    xmlbuf.push_back(0);
+    doc.parse<0>(xmlbuf.data());
+
+    std::vector<uint32_t> out32(n);
+    std::vector<uint16_t> out16(n);
+    std::vector<uint8_t> flags(n);
+    for (unsigned int f = 0; f < 5; f++) {
+        const sDecodeSrc src = {
+            texts[f].data(), texts[f].size(),
+            (encs[f] == eEnc::xml) ? doc.first_node("data") : nullptr
+        };
+        printf("-- %s\n", names[f]);
+
+        const gidDecoder dec32 = findDecoder(encs[f], comps[f]);
+        double t = bench::best([&]() {
+            bench::sink += dec32(src, { out32.data(), nullptr, nullptr, n });
+        });
+        bench::report("specialized, 32-bit", t, (double)n, "tiles");
+        if (out32 != gids)
+            printf("!! 32-bit decoder mismatch\n");
+
+        const gidDecoder split32 = findDecoder(encs[f], comps[f], 32, true);
+        t = bench::best([&]() {
+            bench::sink += split32(src, { out32.data(), flags.data(), nullptr,
+                                          n });
+        });
+        bench::report("specialized, 32-bit split", t, (double)n, "tiles");
+        for (size_t i = 0; i < n; i++)
+            out32[i] |= (uint32_t)flags[i] << 29;
+        if (out32 != gids)
+            printf("!! split decoder mismatch\n");
+
+        const gidDecoder dec16 = findDecoder(encs[f], comps[f], 16);
+        uint32_t lost = 0;
+        t = bench::best([&]() {
+            bench::sink += dec16(src, { out16.data(), nullptr, &lost, n });
+        });
+        bench::report("specialized, 16-bit", t, (double)n, "tiles");
+
+        std::fill(out32.begin(), out32.end(), 0);
+        t = bench::best([&]() {
+            bench::sink += generic(encs[f], comps[f], src, out32.data(), n);
+        });
+        bench::report("generic, switch per tile", t, (double)n, "tiles");
+        if (out32 != gids)
+            printf("!! generic decoder mismatch\n");
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_delta.h"
+
+/**============================================================================
+ * Diff & apply speed and delta size of tile layer deltas, for a few typical
+ * edit patterns on a large layer.
+ ============================================================================*/
+
+#define DELTA_SIZE 2048 //@- Width & height of the layer in tiles.
+
+using namespace tmx;
+
+int main() {
+    const size_t n = (size_t)DELTA_SIZE * DELTA_SIZE;
+    std::mt19937 rng(1);
+
+    std::vector<uint32_t> base(n);
+    for (size_t i = 0; i < n; i++)
+        base[i] = (rng() % 8) ? 1 + rng() % 4 : 0;
+
+    const char* names[] = {
+        "100 scattered tiles", "brush stroke", "256x256 fill", "every tile"
+    };
+
+    for (unsigned int p = 0; p < 4; p++) {
+        std::vector<uint32_t> next = base;
+        if (p == 0)
+            for (unsigned int i = 0; i < 100; i++)
+                next[rng() % n] = 1 + rng() % 64;
+        else if (p == 1)
+            // A 3 tile wide diagonal stroke across the layer.
+            for (unsigned int i = 0; i + 3 < DELTA_SIZE; i++)
+                for (unsigned int k = 0; k < 3; k++)
+                    next[(size_t)i * DELTA_SIZE + i + k] = 9;
+        else if (p == 2)
+            for (unsigned int y = 512; y < 768; y++)
+                for (unsigned int x = 512; x < 768; x++)
+                    next[(size_t)y * DELTA_SIZE + x] = 7 | TMX_FLIP_H;
+        else
+            for (size_t i = 0; i < n; i++)
+                next[i] = 1 + rng() % 200;
+
+        std::vector<uint8_t> delta;
+        printf("-- %s\n", names[p]);
+        double t = bench::best([&]() {
+            bench::sink += diffGids(base.data(), next.data(), DELTA_SIZE,
+                                    DELTA_SIZE, delta);
+        });
+        bench::report("diffGids", t, (double)n, "tiles");
+
+        std::vector<uint32_t> gids;
+        t = bench::best([&]() {
+            gids = base;
+            bench::sink += applyDelta(delta.data(), delta.size(),
+                                      gids.data(), DELTA_SIZE, DELTA_SIZE);
+        });
+        bench::report("applyDelta (with copy)", t, (double)n, "tiles");
+        printf("%-36s %10zu B %10.3f B/tile\n", "delta size", delta.size(),
+               (double)delta.size() / n);
+        if (gids != next)
+            printf("!! delta didn't reproduce the layer\n");
+    }
+    return 0;
+}
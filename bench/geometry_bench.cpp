@@ -0,0 +1,67 @@
+#include <random>
+#include <string>
+
+#include "bench.h"
+#include "tmx_geometry.h"
+
+/**============================================================================
+ * Object geometry of a large object group: rotated rectangles, ellipses and
+ * polygons, built on one thread and on every core, then looked up per
+ * object.
+ ============================================================================*/
+
+#define GEOMETRY_OBJECTS 100000 //@- Objects in the group.
+
+using namespace tmx;
+
+int main() {
+    std::mt19937 rng(1);
+    sNode map = bench::mkMap(1024, 1024);
+    sNode* group = nodeMkNode(map, eTag::objectgroup);
+
+    // Objects are appended at the tail, nodeMkNode walks the whole list.
+    nodeMkNode(*group, eTag::object);
+    TList<sNode>* tail = group->nodes;
+    for (unsigned int i = 0; i < GEOMETRY_OBJECTS; i++) {
+        if (i > 0)
+            tail = tail->append(mkNode(eTag::object));
+        sNode* o = tail->valptr();
+        setNodeVar(*o, mkVar("x", std::to_string(rng() % 16384), eType::dec));
+        setNodeVar(*o, mkVar("y", std::to_string(rng() % 16384), eType::dec));
+        setNodeVar(*o, mkVar("width", "48", eType::dec));
+        setNodeVar(*o, mkVar("height", "32", eType::dec));
+        setNodeVar(*o, mkVar("rotation", std::to_string(rng() % 360),
+                             eType::dec));
+
+        // A third each of rectangles, ellipses and 8 vertex polygons.
+        if (i % 3 == 1)
+            nodeMkNode(*o, eTag::ellipse);
+        else if (i % 3 == 2) {
+            sNode* p = nodeMkNode(*o, eTag::polygon);
+            setNodeVar(*p, mkVar(
+                "points", "0,0 40,-8 64,8 56,40 32,24 16,48 -8,40 8,16",
+                eType::points
+            ));
+        }
+    }
+
+    double t = bench::best([&]() { bench::sink += buildGeometry(map, 1); });
+    bench::report("buildGeometry, 1 thread", t, GEOMETRY_OBJECTS, "objects");
+    t = bench::best([&]() { bench::sink += buildGeometry(map); });
+    bench::report("buildGeometry, all cores", t, GEOMETRY_OBJECTS, "objects");
+
+    // Every object's entry, looked up one by one.
+    t = bench::best([&]() {
+        for (auto it = group->nodes; it; it = it->next())
+            bench::sink += objectGeometry(*group, *it->valptr())->vertices;
+    });
+    bench::report("objectGeometry, every object", t, GEOMETRY_OBJECTS,
+                  "objects");
+
+    const sGeometry* g = group->data->geom;
+    printf("%-36s %10zu\n", "vertices", g->points.size() / 2);
+    printf("%-36s %10zu\n", "triangles", g->indices.size() / 3);
+
+    freeNode(map);
+    return 0;
+}
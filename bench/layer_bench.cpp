@@ -0,0 +1,79 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Tile access cost of each tilelayer representation, on layers of
+ * different densities: random gid() calls, whole layer reads & chunk sized
+ * reads.
+ ============================================================================*/
+
+#define LAYER_SIZE 2048 //@- Width & height of the layers in tiles.
+#define LAYER_LOOKUPS 4000000 //@- Random gid() calls per measurement.
+
+using namespace tmx;
+
+int main() {
+    const char* names[] = { "dense32", "dense16", "rle", "sparse" };
+    const unsigned int fills[] = { 100, 50, 5 };
+    const size_t n = (size_t)LAYER_SIZE * LAYER_SIZE;
+    std::mt19937 rng(1);
+
+    // Random positions, shared by every measurement.
+    std::vector<uint32_t> at(LAYER_LOOKUPS);
+    for (size_t i = 0; i < at.size(); i++)
+        at[i] = rng() % n;
+
+    for (unsigned int f = 0; f < 3; f++) {
+        // Clumped tiles, like the painted areas of a real map.
+        std::vector<uint32_t> gids(n, 0);
+        for (size_t i = 0; i < n; i += 16)
+            if (rng() % 100 < fills[f])
+                for (size_t k = i; k < i + 16; k++)
+                    gids[k] = 1 + rng() % 64;
+
+        printf("-- %u%% filled\n", fills[f]);
+        for (unsigned int s = 0; s < 4; s++) {
+            tilelayer layer(gids.data(), LAYER_SIZE, LAYER_SIZE);
+            if (!layer.convert((eStore)s))
+                continue;
+
+            char name[64];
+            double t = bench::best([&]() {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < at.size(); i++)
+                    sum += layer.gid(at[i] % LAYER_SIZE, at[i] / LAYER_SIZE);
+                bench::sink += sum;
+            });
+            snprintf(name, sizeof(name), "%s gid()", names[s]);
+            bench::report(name, t, (double)at.size(), "tiles");
+
+            std::vector<uint32_t> out(n);
+            t = bench::best([&]() {
+                layer.read(0, 0, LAYER_SIZE, LAYER_SIZE, out.data());
+                bench::sink += out[n / 2];
+            });
+            snprintf(name, sizeof(name), "%s read()", names[s]);
+            bench::report(name, t, (double)n, "tiles");
+
+            // The whole layer chunk by chunk, as the render & collision
+            // builds read it.
+            t = bench::best([&]() {
+                for (unsigned int y = 0; y < LAYER_SIZE; y += TMX_CHUNK_SIZE)
+                    for (unsigned int x = 0; x < LAYER_SIZE;
+                        x += TMX_CHUNK_SIZE
+                    ) {
+                        layer.read(x, y, TMX_CHUNK_SIZE, TMX_CHUNK_SIZE,
+                                   out.data());
+                        bench::sink += out[0];
+                    }
+            });
+            snprintf(name, sizeof(name), "%s read(), per chunk", names[s]);
+            bench::report(name, t, (double)n, "tiles");
+            printf("%-36s %10.2f MB\n", "  memory()", layer.memory() / 1e6);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_nav.h"
+
+/**============================================================================
+ * Navigation grid on a 4096x4096 map: building the grid & clusters,
+ * batched path queries, and the update after scattered tile edits.
+ ============================================================================*/
+
+#define NAV_SIZE 4096 //@- Width & height of the map in tiles.
+#define NAV_QUERIES 200 //@- Path queries per batch.
+#define NAV_EDITS 500 //@- Tiles changed between updates.
+
+using namespace tmx;
+
+int main() {
+    const size_t n = (size_t)NAV_SIZE * NAV_SIZE;
+    std::mt19937 rng(1);
+
+    // Rooms with doorways, plus scattered obstacles.
+    std::vector<uint32_t> gids(n, 0);
+    for (unsigned int y = 0; y < NAV_SIZE; y++)
+        for (unsigned int x = 0; x < NAV_SIZE; x++) {
+            const bool wall = (x % 32 == 0 && y % 32 > 3) ||
+                              (y % 32 == 0 && x % 32 > 3);
+            if (wall || rng() % 10 == 0)
+                gids[(size_t)y * NAV_SIZE + x] = 1;
+        }
+
+    sNode map = bench::mkMap(NAV_SIZE, NAV_SIZE);
+    tilelayer* layer = new tilelayer(gids.data(), NAV_SIZE, NAV_SIZE);
+    bench::addLayer(map, "walls", layer);
+    const std::vector<sWalkRule> rules = { { "walls", "", "", false } };
+
+    navgrid nav;
+    double t = bench::best([&]() { nav = navgrid(map, rules); }, 1);
+    bench::report("build", t, (double)n, "cells");
+
+    // Queries between walkable cells across the whole map.
+    std::vector<sPathQuery> queries;
+    while (queries.size() < NAV_QUERIES) {
+        sPathQuery q = {
+            { (int)(rng() % NAV_SIZE), (int)(rng() % NAV_SIZE) },
+            { (int)(rng() % NAV_SIZE), (int)(rng() % NAV_SIZE) }
+        };
+        if (nav.walkable(q.from.x, q.from.y) && nav.walkable(q.to.x, q.to.y))
+            queries.push_back(q);
+    }
+
+    std::vector<std::vector<sPoint>> paths;
+    t = bench::best([&]() { nav.findPaths(queries, paths, 1); }, 1);
+    bench::report("findPaths, 1 thread", t, NAV_QUERIES, "paths");
+    t = bench::best([&]() { nav.findPaths(queries, paths); }, 1);
+    bench::report("findPaths, all cores", t, NAV_QUERIES, "paths");
+
+    t = bench::best([&]() {
+        for (unsigned int i = 0; i < NAV_EDITS; i++)
+            layer->set(rng() % NAV_SIZE, rng() % NAV_SIZE, rng() % 2);
+        bench::sink += nav.update();
+    });
+    bench::report("update after edits", t, NAV_EDITS, "edits");
+
+    freeNode(map);
+    return 0;
+}
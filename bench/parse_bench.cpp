@@ -0,0 +1,78 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "bench.h"
+#include "tmx_utils.h"
+
+/**============================================================================
+ * Throughput of the gid and point parsing kernels against strtoul/strtof
+ * loops over the same text.
+ ============================================================================*/
+
+#define PARSE_GIDS 4000000 //@- Gids in the CSV text.
+#define PARSE_POINTS 1000000 //@- Points in the point list.
+
+using namespace tmx;
+
+int main() {
+    std::mt19937 rng(1);
+
+    // CSV rows of 100 gids, with flipped tiles now and then.
+    std::string csv;
+    for (size_t i = 0; i < PARSE_GIDS; i++) {
+        uint32_t g = (rng() % 4) ? rng() % 2000 : 0;
+        if (rng() % 16 == 0)
+            g |= 0x80000000u;
+        csv += std::to_string(g);
+        csv += (i % 100 == 99) ? ",\n" : ",";
+    }
+
+    std::vector<uint32_t> gids(PARSE_GIDS);
+    double t = bench::best([&]() {
+        bench::sink += parseGids(csv.data(), csv.size(), gids.data(),
+                                 gids.size());
+    });
+    bench::report("parseGids", t, csv.size(), "B");
+
+    t = bench::best([&]() {
+        const char* at = csv.c_str();
+        char* end;
+        size_t n = 0;
+        while (n < gids.size()) {
+            gids[n++] = strtoul(at, &end, 10);
+            at = end + 1;
+        }
+        bench::sink += n;
+    });
+    bench::report("strtoul", t, csv.size(), "B");
+
+    // Polygon points with up to 2 decimals.
+    std::string points;
+    for (size_t i = 0; i < PARSE_POINTS; i++) {
+        points += std::to_string(rng() % 5000) + "." +
+                  std::to_string(rng() % 100) + ",-" +
+                  std::to_string(rng() % 5000) + " ";
+    }
+
+    std::vector<float> xy(PARSE_POINTS * 2);
+    t = bench::best([&]() {
+        bench::sink += parsePoints(points.data(), points.size(), xy.data(),
+                                   xy.size());
+    });
+    bench::report("parsePoints", t, points.size(), "B");
+
+    t = bench::best([&]() {
+        const char* at = points.c_str();
+        char* end;
+        size_t n = 0;
+        while (n < xy.size()) {
+            xy[n++] = strtof(at, &end);
+            at = end + 1;
+        }
+        bench::sink += n;
+    });
+    bench::report("strtof", t, points.size(), "B");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "tmx_pyramid.h"
+
+/**============================================================================
+ * Layer pyramid of a 4096x4096 layer: building it with each sampling mode,
+ * the update after scattered edits, and reading a zoomed-out view against
+ * reading the full resolution layer.
+ ============================================================================*/
+
+#define PYRAMID_SIZE 4096 //@- Width & height of the layer in tiles.
+#define PYRAMID_EDITS 1000 //@- Tiles changed between updates.
+#define PYRAMID_LEVEL 3 //@- Level of the zoomed-out view. (8x)
+
+using namespace tmx;
+
+int main() {
+    const size_t n = (size_t)PYRAMID_SIZE * PYRAMID_SIZE;
+    std::mt19937 rng(1);
+
+    // Patches of terrain with noise.
+    std::vector<uint32_t> gids(n);
+    for (unsigned int y = 0; y < PYRAMID_SIZE; y++)
+        for (unsigned int x = 0; x < PYRAMID_SIZE; x++)
+            gids[(size_t)y * PYRAMID_SIZE + x] =
+                (rng() % 8) ? 1 + (x / 64 + y / 64) % 6 : 1 + rng() % 16;
+    tilelayer layer(gids.data(), PYRAMID_SIZE, PYRAMID_SIZE);
+
+    std::vector<uint32_t> priority(17);
+    for (unsigned int i = 0; i < priority.size(); i++)
+        priority[i] = i;
+
+    pyramid p;
+    double t = bench::best([&]() {
+        p = pyramid(&layer, eSample::majority, priority, 0, 1);
+    }, 1);
+    bench::report("build majority, 1 thread", t, (double)n, "tiles");
+    t = bench::best([&]() { p = pyramid(&layer, eSample::majority); }, 1);
+    bench::report("build majority, all cores", t, (double)n, "tiles");
+    t = bench::best([&]() {
+        p = pyramid(&layer, eSample::priority, priority);
+    }, 1);
+    bench::report("build priority, all cores", t, (double)n, "tiles");
+
+    t = bench::best([&]() {
+        for (unsigned int i = 0; i < PYRAMID_EDITS; i++)
+            layer.set(rng() % PYRAMID_SIZE, rng() % PYRAMID_SIZE,
+                      1 + rng() % 16);
+        bench::sink += p.update();
+    });
+    bench::report("update after edits", t, PYRAMID_EDITS, "edits");
+
+    // The whole map at 8x zoom out, against the tiles it summarizes.
+    const unsigned int w = p.width(PYRAMID_LEVEL), h = p.height(PYRAMID_LEVEL);
+    std::vector<uint32_t> view((size_t)w * h);
+    t = bench::best([&]() {
+        p.read(PYRAMID_LEVEL, 0, 0, w, h, view.data());
+        bench::sink += view[0];
+    });
+    bench::report("read level 3", t, (double)w * h, "cells");
+
+    t = bench::best([&]() {
+        layer.read(0, 0, PYRAMID_SIZE, PYRAMID_SIZE, gids.data());
+        bench::sink += gids[0];
+    });
+    bench::report("read full resolution", t, (double)n, "tiles");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "tmx_world.h"
+
+/**============================================================================
+ * World streaming: the player walks across a grid of 256x256 tile maps under
+ * a memory budget of a few maps, reporting the cost of update() & get(),
+ * the hit rate and the load latency.
+ ============================================================================*/
+
+#define WORLD_MAP_SIZE 256 //@- Width & height of each map in tiles.
+#define WORLD_STEPS 2000 //@- Frames of the walk.
+#define WORLD_BUDGET 9 //@- Memory budget, in maps.
+
+using namespace tmx;
+
+/**
+ * Writes the map every cell of the world loads.
+ *
+ * @param p_path Path of the map.
+ * @returns [bool] False if the file couldn't be written.
+ */
+static bool writeMap(const char* p_path) {
+    FILE* f = fopen(p_path, "w");
+    if (f == nullptr)
+        return false;
+
+    std::mt19937 rng(1);
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<map version=\"1.0\" orientation=\"orthogonal\" width=\"%d\" "
+               "height=\"%d\" tilewidth=\"16\" tileheight=\"16\">\n"
+               " <tileset firstgid=\"1\" name=\"ground\" tilewidth=\"16\" "
+               "tileheight=\"16\" tilecount=\"16\" columns=\"4\"/>\n"
+               " <layer name=\"ground\" width=\"%d\" height=\"%d\">\n"
+               "  <data encoding=\"csv\">\n",
+            WORLD_MAP_SIZE, WORLD_MAP_SIZE, WORLD_MAP_SIZE, WORLD_MAP_SIZE);
+    for (unsigned int i = 0; i < WORLD_MAP_SIZE * WORLD_MAP_SIZE; i++)
+        fprintf(f, (i + 1 < WORLD_MAP_SIZE * WORLD_MAP_SIZE) ? "%u," : "%u",
+                1 + (unsigned int)(rng() % 16));
+    fprintf(f, "\n  </data>\n </layer>\n</map>\n");
+    return fclose(f) == 0;
+}
+
+int main() {
+    const char* path = "world_bench.tmx";
+    if (!writeMap(path)) {
+        printf("!! couldn't write %s\n", path);
+        return 1;
+    }
+
+    // Size of one loaded map, for the budget.
+    sNode probe = load(path);
+    const size_t bytes = nodeMemory(probe);
+    freeNode(probe);
+
+    const float cell = WORLD_MAP_SIZE * 16;
+    world w([path](int, int) { return std::string(path); }, cell, cell,
+            bytes * WORLD_BUDGET);
+
+    // Walks diagonally across the world, about 2 maps per 1000 frames.
+    double tupdate = 0, tget = 0;
+    for (unsigned int i = 0; i < WORLD_STEPS; i++) {
+        const float x = i * cell / 500, y = i * cell / 700;
+        tupdate += bench::best([&]() { w.update(x, y, cell * 0.75f); }, 1);
+        tget += bench::best([&]() {
+            bench::sink += (w.get((int)(x / cell), (int)(y / cell)) != nullptr);
+        }, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bench::report("update", tupdate, WORLD_STEPS, "calls");
+    bench::report("get", tget, WORLD_STEPS, "calls");
+
+    const sWorldStats s = w.stats();
+    printf("%-36s %10zu KB\n", "map size", bytes / 1024);
+    printf("%-36s %10.1f %%\n", "hit rate",
+           100.0 * s.hits / std::max<uint64_t>(1, s.hits + s.misses));
+    printf("%-36s %10llu\n", "loads", (unsigned long long)s.loads);
+    printf("%-36s %10llu\n", "evictions", (unsigned long long)s.evictions);
+    printf("%-36s %10.3f ms\n", "load latency, average", s.latencyavg);
+    printf("%-36s %10.3f ms\n", "load latency, longest", s.latencymax);
+
+    remove(path);
+    return 0;
+}
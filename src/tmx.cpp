@@ -33,6 +33,18 @@ namespace tmx {
         return mkData("\"", eEnc::text);
     }
 
+    tilelayer* tmxnode::tiles(){
+        if(tag() == eTag::data)
+            return (_mynode.data != nullptr) ? _mynode.data->tiles : nullptr;
+
+        // Layers hold their tiles in their <data> child node.
+        if(tag() == eTag::layer)
+            for(auto it = _mynode.nodes; it; it = it->next())
+                if(it->valptr()->tag == eTag::data && it->valptr()->data)
+                    return it->valptr()->data->tiles;
+        return nullptr;
+    }
+
     bool tmxnode::pollChildren(tmxnode& p_to){
         // Check if the end of child nodes has been reached.
         if(_childiter == nullptr){
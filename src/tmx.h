@@ -45,6 +45,13 @@ namespace tmx {
 
         sData data();
 
+        /**
+         * Get the decoded tiles of this <layer> or <data> node.
+         *
+         * @returns [tilelayer*] The node's tiles, nullptr if it has none.
+         */
+        tilelayer* tiles();
+
         /**
          * Poll over all this node's child nodes.
          *
@@ -0,0 +1,153 @@
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+#include "tmx_async.h"
+
+namespace tmx {
+    // State shared between a load handle and its loading thread.
+    struct sAsyncState {
+        sLoadCtl ctl;
+        std::mutex lock;
+        std::condition_variable done_cv;
+        bool done = false;
+        sNode result = mkNode(eTag::ignore);
+        std::exception_ptr error;
+        std::vector<std::function<void()>> continuations;
+    };
+
+    /**
+     * Body of an asynchronous load. Runs on the executor's thread.
+     *
+     * @param p_state State shared with the load's handles.
+     * @param p_path The path to the TMX map file.
+     */
+    static void runLoad(std::shared_ptr<sAsyncState> p_state, str_p p_path) {
+        sNode map = mkNode(eTag::ignore);
+        std::exception_ptr error;
+
+        try {
+            map = load(p_path, &p_state->ctl);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // Publish the result and take the continuations to run.
+        std::vector<std::function<void()>> continuations;
+        {
+            std::lock_guard<std::mutex> guard(p_state->lock);
+            p_state->result = map;
+            p_state->error = error;
+            p_state->done = true;
+            continuations.swap(p_state->continuations);
+        }
+        p_state->done_cv.notify_all();
+
+        for (unsigned int i = 0; i < continuations.size(); i++)
+            continuations.at(i)();
+    }
+
+    loadhandle::loadhandle() {}
+
+    loadhandle::loadhandle(const std::shared_ptr<sAsyncState>& p_state) {
+        _state = p_state;
+    }
+
+    bool loadhandle::valid() const {
+        return _state != nullptr;
+    }
+
+    bool loadhandle::ready() const {
+        if (!valid())
+            return true;
+        std::lock_guard<std::mutex> guard(_state->lock);
+        return _state->done;
+    }
+
+    void loadhandle::wait() const {
+        if (!valid())
+            return;
+        std::unique_lock<std::mutex> guard(_state->lock);
+        _state->done_cv.wait(guard, [this]() { return _state->done; });
+    }
+
+    bool loadhandle::waitFor(std::chrono::milliseconds p_timeout) const {
+        if (!valid())
+            return true;
+        std::unique_lock<std::mutex> guard(_state->lock);
+        return _state->done_cv.wait_for(
+            guard,
+            p_timeout,
+            [this]() { return _state->done; }
+        );
+    }
+
+    sNode loadhandle::get() const {
+        if (!valid())
+            return mkNode(eTag::ignore);
+        wait();
+        if (_state->error)
+            std::rethrow_exception(_state->error);
+        return _state->result;
+    }
+
+    void loadhandle::cancel() {
+        if (valid())
+            _state->ctl.cancel = true;
+    }
+
+    bool loadhandle::cancelled() const {
+        return valid() && _state->ctl.cancel.load();
+    }
+
+    sLoadProgress loadhandle::progress() const {
+        if (!valid())
+            return { 0, 0, 0, 0 };
+        return {
+            _state->ctl.bytes.load(),
+            _state->ctl.bytestotal.load(),
+            _state->ctl.layers.load(),
+            _state->ctl.layerstotal.load()
+        };
+    }
+
+    void loadhandle::then(const std::function<void()>& p_fn) {
+        if (!defer(p_fn))
+            p_fn();
+    }
+
+    bool loadhandle::defer(const std::function<void()>& p_fn) {
+        if (!valid())
+            return false;
+        std::lock_guard<std::mutex> guard(_state->lock);
+        if (_state->done)
+            return false;
+        _state->continuations.push_back(p_fn);
+        return true;
+    }
+
+    loadhandle loadAsync(str_p p_path, const sAsyncOpts& p_opts) {
+        std::shared_ptr<sAsyncState> state = std::make_shared<sAsyncState>();
+        state->ctl.geometry = p_opts.geometry;
+
+        // Forward layer progress to the user's callback.
+        if (p_opts.onprogress) {
+            std::function<void(const sLoadProgress&)> cb = p_opts.onprogress;
+            sLoadCtl* ctl = &state->ctl;
+            ctl->progress = [cb, ctl](size_t p_bytes, unsigned int p_layers) {
+                cb({p_bytes, ctl->bytestotal, p_layers, ctl->layerstotal});
+            };
+        }
+
+        std::string path = p_path;
+        std::function<void()> task = [state, path]() { runLoad(state, path); };
+
+        if (p_opts.exec)
+            p_opts.exec(task);
+        else
+            std::thread(task).detach();
+
+        return loadhandle(state);
+    }
+}
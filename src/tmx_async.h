@@ -0,0 +1,154 @@
+#ifndef LM_TMX_ASYNC_H
+#define LM_TMX_ASYNC_H
+
+#include <chrono>
+#include <memory>
+#include <functional>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define TMX_HAS_COROUTINES
+#endif
+#endif
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Asynchronous TMX map loading. Maps are loaded by the core loader on an
+ * executor of the caller's choosing while the caller polls, waits on or
+ * awaits the returned handle.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Executor type. Runs the given task, now or later, on any thread.
+    typedef std::function<void(const std::function<void()>&)> executor;
+
+    // Snapshot of a load's progress.
+    struct sLoadProgress {
+        size_t bytes;
+        size_t bytestotal;
+        unsigned int layers;
+        unsigned int layerstotal;
+    };
+
+    // Asynchronous load options.
+    struct sAsyncOpts {
+        //@- Executor to run the load on. Defaults to a new detached thread.
+        executor exec;
+        //@- Called from the loading thread each time a layer finishes.
+        std::function<void(const sLoadProgress&)> onprogress;
+        //@- Build the object geometry once loaded. (see tmx_geometry.h)
+        bool geometry;
+
+        sAsyncOpts() : geometry(false) {}
+        explicit sAsyncOpts(const executor& p_exec)
+            : exec(p_exec), geometry(false) {}
+        sAsyncOpts(
+            const executor& p_exec,
+            const std::function<void(const sLoadProgress&)>& p_onprogress,
+            bool p_geometry = false
+        ) : exec(p_exec), onprogress(p_onprogress), geometry(p_geometry) {}
+    };
+
+    struct sAsyncState;
+
+    class loadhandle {
+    public:
+        loadhandle();
+        loadhandle(const std::shared_ptr<sAsyncState>& p_state);
+
+        /**
+         * A default constructed handle refers to no load. It acts as a
+         * finished load of nothing: it's ready, get() returns an <ignore>
+         * node and then() calls its function immediately.
+         *
+         * @returns [bool] Whether or not the handle refers to a load.
+         */
+        bool valid() const;
+
+        /** @returns [bool] Whether or not the load has finished. */
+        bool ready() const;
+
+        /** Blocks until the load has finished. */
+        void wait() const;
+
+        /**
+         * Blocks until the load has finished or the timeout expires.
+         *
+         * @param p_timeout Longest time to wait for.
+         * @returns [bool] Whether or not the load has finished.
+         */
+        bool waitFor(std::chrono::milliseconds p_timeout) const;
+
+        /**
+         * Waits for the load and returns the loaded map. Ownership of the
+         * map's memory passes to the caller, free it with freeNode.
+         *
+         * Rethrows any exception raised while loading. (ie. missing file)
+         *
+         * @returns [sNode] The loaded map, or an <ignore> node if the load...
+         * ...was cancelled.
+         */
+        sNode get() const;
+
+        /**
+         * Requests the load to stop. Whatever was built so far is released
+         * by the loading thread. Has no effect on a finished load.
+         */
+        void cancel();
+
+        /** @returns [bool] Whether or not a cancel has been requested. */
+        bool cancelled() const;
+
+        /** @returns [sLoadProgress] Current progress of the load. */
+        sLoadProgress progress() const;
+
+        /**
+         * Registers a function to call once the load finishes. Called from
+         * the loading thread, or immediately if the load already finished.
+         *
+         * @param p_fn Function to call.
+         */
+        void then(const std::function<void()>& p_fn);
+
+#ifdef TMX_HAS_COROUTINES
+        // Awaitable wrapper resuming the coroutine on the loading thread.
+        struct awaiter {
+            loadhandle* handle;
+
+            bool await_ready() const { return handle->ready(); }
+            bool await_suspend(std::coroutine_handle<> p_co) {
+                return handle->defer([p_co]() { p_co.resume(); });
+            }
+            sNode await_resume() const { return handle->get(); }
+        };
+
+        awaiter operator co_await() { return awaiter{this}; }
+#endif
+    private:
+        /**
+         * Registers a function to call once the load finishes.
+         *
+         * @param p_fn Function to call.
+         * @returns [bool] false = already finished, p_fn was not registered.
+         */
+        bool defer(const std::function<void()>& p_fn);
+
+        std::shared_ptr<sAsyncState> _state;
+    };
+
+    /**
+     * Starts loading the TMX map file at the given path without blocking.
+     *
+     * @param p_path The path to the TMX map file.
+     * @param p_opts Load options. Defaults to a detached thread.
+     * @returns [loadhandle] Handle to poll, wait on or await the load.
+     */
+    loadhandle loadAsync(str_p p_path, const sAsyncOpts& p_opts = sAsyncOpts());
+}
+
+#endif
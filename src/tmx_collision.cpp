@@ -0,0 +1,313 @@
+#include <algorithm>
+
+#include "tmx_collision.h"
+#include "tmx_tileset.h"
+#include "tmx_utils.h"
+
+/**
+ * Merges rectangles sharing an edge along one axis. Rectangles lined up on
+ * the same row (or column) with the same height (or width) are joined.
+ *
+ * @param p_rects Rectangles to merge, merged in place.
+ * @param p_vertical false = merge along rows, true = along columns.
+ */
+static void mergeRects(std::vector<tmx::sRect>& p_rects, bool p_vertical) {
+    using tmx::sRect;
+    if (p_rects.size() < 2)
+        return;
+
+    // Line the rectangles up along the axis they are merged on.
+    std::sort(p_rects.begin(), p_rects.end(),
+        [p_vertical](const sRect& a, const sRect& b) {
+            if (p_vertical) {
+                if (a.x != b.x) return a.x < b.x;
+                if (a.w != b.w) return a.w < b.w;
+                return a.y < b.y;
+            }
+            if (a.y != b.y) return a.y < b.y;
+            if (a.h != b.h) return a.h < b.h;
+            return a.x < b.x;
+        }
+    );
+
+    std::vector<sRect> merged;
+    merged.push_back(p_rects.front());
+    for (unsigned int i = 1; i < p_rects.size(); i++) {
+        sRect& last = merged.back();
+        const sRect& r = p_rects.at(i);
+
+        if (p_vertical && r.x == last.x && r.w == last.w &&
+            r.y == last.y + last.h)
+            last.h += r.h;
+        else if (!p_vertical && r.y == last.y && r.h == last.h &&
+            r.x == last.x + last.w)
+            last.w += r.w;
+        else
+            merged.push_back(r);
+    }
+    p_rects.swap(merged);
+}
+
+/**
+ * Get the area a tile's collision object covers. Rectangles & ellipses
+ * cover their box, polygons the bounding box of their points.
+ *
+ * @param p_obj The <object> node, relative to its tile.
+ * @param p_out Set to the covered area.
+ * @returns [bool] Whether or not the object covers any area. (polylines...
+ * ...& empty shapes don't)
+ */
+static bool shapeBounds(const tmx::sNode& p_obj, tmx::sRect& p_out) {
+    using namespace tmx;
+    p_out = {
+        (float)valDec(getNodeVar(p_obj, "x")),
+        (float)valDec(getNodeVar(p_obj, "y")),
+        (float)valDec(getNodeVar(p_obj, "width")),
+        (float)valDec(getNodeVar(p_obj, "height"))
+    };
+
+    for (auto it = p_obj.nodes; it; it = it->next()) {
+        const eTag t = it->valptr()->tag;
+        if (t == eTag::polyline)
+            return false;
+        if (t != eTag::polygon)
+            continue;
+
+        const std::string pts = getNodeVar(*it->valptr(), "points").value;
+        std::vector<float> p(pts.size() + 2);
+        const size_t n = parsePoints(pts.c_str(), pts.size(), p.data(),
+                                     p.size()) & ~(size_t)1;
+        if (n == 0)
+            return false;
+
+        float minx = p[0], miny = p[1], maxx = p[0], maxy = p[1];
+        for (size_t i = 2; i < n; i += 2) {
+            minx = std::min(minx, p[i]);
+            maxx = std::max(maxx, p[i]);
+            miny = std::min(miny, p[i + 1]);
+            maxy = std::max(maxy, p[i + 1]);
+        }
+        p_out = { p_out.x + minx, p_out.y + miny, maxx - minx, maxy - miny };
+        break;
+    }
+    return p_out.w > 0 && p_out.h > 0;
+}
+
+namespace tmx {
+    collider::collider() {
+        _layer = nullptr;
+        _chunk = 0;
+        _cx = 0;
+        _cy = 0;
+        _tw = 0;
+        _th = 0;
+    }
+
+    collider::collider(
+        sNode& p_map,
+        const tilelayer* p_layer,
+        str_p p_prop,
+        str_p p_value,
+        unsigned int p_chunk
+    ) {
+        _layer = p_layer;
+        _tw = valInt(getNodeVar(p_map, "tilewidth"));
+        _th = valInt(getNodeVar(p_map, "tileheight"));
+
+        // A chunk size of 0 covers the whole layer.
+        _chunk = p_chunk;
+        if (_chunk == 0)
+            _chunk = std::max(1u, std::max(_layer->width(), _layer->height()));
+        _cx = (_layer->width() + _chunk - 1) / _chunk;
+        _cy = (_layer->height() + _chunk - 1) / _chunk;
+        _chunks.resize((size_t)_cx * _cy);
+        for (unsigned int i = 0; i < _chunks.size(); i++) {
+            _chunks.at(i).rev = 0;
+            _chunks.at(i).built = false;
+        }
+
+        std::vector<sTileset> sets = loadTilesets(p_map);
+        _solid.assign(maxGid(sets) + 1, 0);
+
+        // Gather the solid tiles and collision shapes of each tileset.
+        for (unsigned int s = 0; s < sets.size(); s++) {
+            const sTileset& ts = sets.at(s);
+            for (auto it = ts.node->nodes; it; it = it->next()) {
+                sNode& tile = *it->valptr();
+                if (tile.tag != eTag::tile)
+                    continue;
+
+                const long id = valInt(getNodeVar(tile, "id"), -1);
+                if (id < 0 || (uint32_t)id >= ts.count)
+                    continue;
+                const uint32_t gid = ts.firstgid + id;
+
+                sVal v = getNodeVar(tile, p_prop, true);
+                if (v.type != eType::error && v.value == p_value)
+                    _solid[gid] = 1;
+
+                for (auto g = tile.nodes; g; g = g->next()) {
+                    if (g->valptr()->tag != eTag::objectgroup)
+                        continue;
+
+                    for (auto o = g->valptr()->nodes; o; o = o->next()) {
+                        sRect r;
+                        if (o->valptr()->tag != eTag::object ||
+                            !shapeBounds(*o->valptr(), r))
+                            continue;
+
+                        // Shapes covering the whole tile make it solid.
+                        if (r.x <= 0 && r.y <= 0 &&
+                            r.x + r.w >= ts.tilewidth &&
+                            r.y + r.h >= ts.tileheight)
+                            _solid[gid] = 1;
+                        else {
+                            sShapes& shapes = _shapes[gid];
+                            shapes.rects.push_back(r);
+                            shapes.w = (float)ts.tilewidth;
+                            shapes.h = (float)ts.tileheight;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int collider::update(unsigned int p_threads) {
+        // Find the chunks whose tiles changed.
+        std::vector<unsigned int> stale;
+        for (unsigned int cy = 0; cy < _cy; cy++)
+            for (unsigned int cx = 0; cx < _cx; cx++) {
+                sChunk& c = _chunks[cy * _cx + cx];
+                uint64_t rev = _layer->revision(
+                    cx * _chunk, cy * _chunk, _chunk, _chunk
+                );
+                if (!c.built || c.rev != rev) {
+                    c.rev = rev;
+                    stale.push_back(cy * _cx + cx);
+                }
+            }
+
+        parallelFor(stale.size(), [&](size_t i) {
+            const unsigned int c = stale.at(i);
+            build(c % _cx, c / _cx, _chunks[c]);
+        }, p_threads);
+
+        return stale.size();
+    }
+
+    unsigned int collider::chunksX() const { return _cx; }
+    unsigned int collider::chunksY() const { return _cy; }
+
+    const std::vector<sRect>& collider::rects(
+        unsigned int p_cx,
+        unsigned int p_cy
+    ) const {
+        return _chunks.at(p_cy * _cx + p_cx).rects;
+    }
+
+    std::vector<sRect> collider::rects() const {
+        std::vector<sRect> all;
+        for (unsigned int i = 0; i < _chunks.size(); i++)
+            all.insert(all.end(),
+                _chunks.at(i).rects.begin(),
+                _chunks.at(i).rects.end()
+            );
+        return all;
+    }
+
+    void collider::build(
+        unsigned int p_cx,
+        unsigned int p_cy,
+        sChunk& p_chunk
+    ) const {
+        const unsigned int x0 = p_cx * _chunk, y0 = p_cy * _chunk;
+        const unsigned int w = std::min(_chunk, _layer->width() - x0);
+        const unsigned int h = std::min(_chunk, _layer->height() - y0);
+
+        std::vector<uint32_t> gids((size_t)w * h);
+        _layer->read(x0, y0, w, h, gids.data());
+
+        // Mark the solid cells, cells already merged get cleared.
+        std::vector<char> open((size_t)w * h);
+        for (size_t i = 0; i < gids.size(); i++) {
+            const uint32_t g = gids[i] & TMX_GID_MASK;
+            open[i] = (g < _solid.size()) ? _solid[g] : 0;
+        }
+
+        p_chunk.rects.clear();
+
+        // Greedily grow rectangles right, then down, from each open cell.
+        for (unsigned int y = 0; y < h; y++)
+            for (unsigned int x = 0; x < w; x++) {
+                if (!open[y * w + x])
+                    continue;
+
+                unsigned int rw = 1;
+                while (x + rw < w && open[y * w + x + rw])
+                    rw++;
+
+                unsigned int rh = 1;
+                for (bool grow = true; grow && y + rh < h;) {
+                    for (unsigned int i = 0; i < rw; i++)
+                        if (!open[(y + rh) * w + x + i]) {
+                            grow = false;
+                            break;
+                        }
+                    if (grow)
+                        rh++;
+                }
+
+                for (unsigned int j = 0; j < rh; j++)
+                    for (unsigned int i = 0; i < rw; i++)
+                        open[(y + j) * w + x + i] = 0;
+
+                p_chunk.rects.push_back({
+                    (x0 + x) * _tw, (y0 + y) * _th, rw * _tw, rh * _th
+                });
+            }
+
+        // Place the partial collision shapes of non-solid tiles.
+        std::vector<sRect> shapes;
+        for (unsigned int y = 0; y < h && !_shapes.empty(); y++)
+            for (unsigned int x = 0; x < w; x++) {
+                const uint32_t gid = gids[y * w + x];
+                const uint32_t g = gid & TMX_GID_MASK;
+                if (g == 0 || (g < _solid.size() && _solid[g]))
+                    continue;
+
+                auto it = _shapes.find(g);
+                if (it == _shapes.end())
+                    continue;
+
+                const sShapes& tile = it->second;
+                for (unsigned int i = 0; i < tile.rects.size(); i++) {
+                    sRect r = tile.rects.at(i);
+                    float tw = tile.w, th = tile.h;
+
+                    // Apply the tile's flips within the tileset's tile.
+                    // (diagonal first, like Tiled)
+                    if (gid & TMX_FLIP_D) {
+                        std::swap(r.x, r.y);
+                        std::swap(r.w, r.h);
+                        std::swap(tw, th);
+                    }
+                    if (gid & TMX_FLIP_H)
+                        r.x = tw - r.x - r.w;
+                    if (gid & TMX_FLIP_V)
+                        r.y = th - r.y - r.h;
+
+                    // Tiles of another size than the map's are aligned to
+                    // the cell bottom.
+                    r.x += (x0 + x) * _tw;
+                    r.y += (y0 + y) * _th + _th - th;
+                    shapes.push_back(r);
+                }
+            }
+
+        mergeRects(shapes, false);
+        mergeRects(shapes, true);
+        p_chunk.rects.insert(p_chunk.rects.end(), shapes.begin(), shapes.end());
+        p_chunk.built = true;
+    }
+}
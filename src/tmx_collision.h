@@ -0,0 +1,101 @@
+#ifndef LM_TMX_COLLISION_H
+#define LM_TMX_COLLISION_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Collision geometry generated from tile layers. Solid tiles are merged into
+ * as few rectangles as possible and the collision objects of tileset tiles
+ * are placed and merged alongside them, chunk by chunk.
+ *
+ * Collision objects take part as rectangles: ellipses & polygons as their
+ * bounding box, unrotated. Polylines don't enclose an area and are ignored.
+ *
+ * Rectangles are in orthogonal map pixels. (column * tilewidth, ...)
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Rectangle structure.
+    struct sRect { float x; float y; float w; float h; };
+
+    class collider {
+    public:
+        collider();
+
+        /**
+         * Sets up collision generation for a layer. Tiles are solid if their
+         * tileset <tile> has the given property value or a collision object
+         * covering the whole tile. Call update() to generate the geometry.
+         *
+         * @param p_map The root <map> node the layer belongs to.
+         * @param p_layer The layer's tiles.
+         * @param p_prop Name of the property marking solid tiles.
+         * @param p_value Value of the property marking solid tiles.
+         * @param p_chunk Width & height in tiles of each output chunk...
+         * ...0 = one chunk covering the whole layer.
+         */
+        collider(
+            sNode& p_map,
+            const tilelayer* p_layer,
+            str_p p_prop = "solid",
+            str_p p_value = "true",
+            unsigned int p_chunk = TMX_CHUNK_SIZE
+        );
+
+        /**
+         * Regenerates the chunks whose tiles changed since they were last
+         * generated, in parallel.
+         *
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         * @returns [unsigned int] Number of chunks regenerated.
+         */
+        unsigned int update(unsigned int p_threads = 0);
+
+        /** @returns [unsigned int] Number of chunk columns. */
+        unsigned int chunksX() const;
+        /** @returns [unsigned int] Number of chunk rows. */
+        unsigned int chunksY() const;
+
+        /**
+         * Get the collision rectangles of a chunk.
+         *
+         * @param p_cx Chunk column.
+         * @param p_cy Chunk row.
+         * @returns [const std::vector<sRect>&] The chunk's rectangles.
+         */
+        const std::vector<sRect>& rects(unsigned int p_cx, unsigned int p_cy) const;
+
+        /** @returns [std::vector<sRect>] Rectangles of all chunks. */
+        std::vector<sRect> rects() const;
+    private:
+        // Generated chunk.
+        struct sChunk { std::vector<sRect> rects; uint64_t rev; bool built; };
+        // Partial collision rectangles of a tile, relative to the tile, and
+        // the size of its tileset's tiles.
+        struct sShapes { std::vector<sRect> rects; float w; float h; };
+
+        void build(unsigned int p_cx, unsigned int p_cy, sChunk& p_chunk) const;
+
+        const tilelayer* _layer; //@- Layer to generate geometry for.
+        unsigned int _chunk; //@- Chunk size in tiles.
+        unsigned int _cx; //@- Chunk columns.
+        unsigned int _cy; //@- Chunk rows.
+        float _tw; //@- Map tile width in pixels.
+        float _th; //@- Map tile height in pixels.
+
+        std::vector<char> _solid; //@- Whether each gid is solid.
+        //@- Partial collision rectangles of each gid.
+        std::unordered_map<uint32_t, sShapes> _shapes;
+        std::vector<sChunk> _chunks;
+    };
+}
+
+#endif
@@ -0,0 +1,447 @@
+#include <cmath>
+
+#include "tmx_coords.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define TMX_SIMD_COORDS
+#endif
+
+/**
+ * Get the position of a cell on a staggered axis. (b) Every other line
+ * along it is shifted by half a cell along the other axis. (a)
+ *
+ * @param p_a Cell coordinate along the other axis.
+ * @param p_b Cell coordinate along the stagger axis.
+ * @param p_wa Size of a cell along the other axis.
+ * @param p_step Distance between lines along the stagger axis.
+ * @param p_even Whether even instead of odd lines are shifted.
+ * @param p_pa Pixel coordinate along the other axis to write to.
+ * @param p_pb Pixel coordinate along the stagger axis to write to.
+ */
+static inline void stagToPixel(int p_a, int p_b, float p_wa, float p_step,
+                               bool p_even, float& p_pa, float& p_pb) {
+    const int s = (p_b & 1) ^ (int)p_even;
+    p_pa = p_a * p_wa + s * (p_wa / 2);
+    p_pb = p_b * p_step;
+}
+
+/**
+ * Get the staggered cell holding a position. Only the cell of the line the
+ * position falls in and the one of the line before can hold it. The first
+ * one is tested against its diamond/hexagon, the other one holds it if that
+ * test fails.
+ *
+ * @param p_wb Size of a cell along the stagger axis.
+ * @param p_side Length of a hexagon's flat side, 0 for diamonds.
+ */
+static inline void stagToTile(float p_pa, float p_pb, float p_wa, float p_wb,
+                              float p_side, float p_step, bool p_even,
+                              int& p_a, int& p_b) {
+    int b = (int)std::floor(p_pb / p_step);
+    int s = (b & 1) ^ (int)p_even;
+    int a = (int)std::floor((p_pa - s * (p_wa / 2)) / p_wa);
+
+    const float ca = (a * p_wa + s * (p_wa / 2)) + p_wa / 2;
+    const float cb = b * p_step + p_wb / 2;
+    const float slope = (p_wb - p_side) / p_wa;
+    if (std::fabs(p_pb - cb) > p_wb / 2 - slope * std::fabs(p_pa - ca)) {
+        b--;
+        s ^= 1;
+        a = (int)std::floor((p_pa - s * (p_wa / 2)) / p_wa);
+    }
+    p_a = a;
+    p_b = b;
+}
+
+#ifdef TMX_SIMD_COORDS
+/** @returns [__m128i] Lanes rounded towards negative infinity. */
+static inline __m128i floor4(__m128 p_v) {
+    const __m128i t = _mm_cvttps_epi32(p_v);
+    // Truncation rounded negative values up, the mask is -1 for those.
+    return _mm_add_epi32(
+        t, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), p_v)));
+}
+
+/** @returns [__m128] Absolute value of the lanes. */
+static inline __m128 abs4(__m128 p_v) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), p_v);
+}
+
+/** 4 lane version of stagToPixel. */
+static inline void stagToPixel4(__m128i p_a, __m128i p_b, float p_wa,
+                                float p_step, bool p_even,
+                                __m128& p_pa, __m128& p_pb) {
+    const __m128i s = _mm_xor_si128(_mm_and_si128(p_b, _mm_set1_epi32(1)),
+                                    _mm_set1_epi32(p_even));
+    p_pa = _mm_add_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(p_a), _mm_set1_ps(p_wa)),
+        _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(p_wa / 2)));
+    p_pb = _mm_mul_ps(_mm_cvtepi32_ps(p_b), _mm_set1_ps(p_step));
+}
+
+/** 4 lane version of stagToTile, both candidates are computed and blended. */
+static inline void stagToTile4(__m128 p_pa, __m128 p_pb, float p_wa,
+                               float p_wb, float p_side, float p_step,
+                               bool p_even, __m128i& p_a, __m128i& p_b) {
+    const __m128 wa = _mm_set1_ps(p_wa);
+    const __m128 halfa = _mm_set1_ps(p_wa / 2);
+    const __m128i one = _mm_set1_epi32(1);
+
+    const __m128i b = floor4(_mm_div_ps(p_pb, _mm_set1_ps(p_step)));
+    const __m128i s = _mm_xor_si128(_mm_and_si128(b, one),
+                                    _mm_set1_epi32(p_even));
+    const __m128 off = _mm_mul_ps(_mm_cvtepi32_ps(s), halfa);
+    const __m128i a = floor4(_mm_div_ps(_mm_sub_ps(p_pa, off), wa));
+
+    const __m128 ca = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), wa), off), halfa);
+    const __m128 cb = _mm_add_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(b), _mm_set1_ps(p_step)),
+        _mm_set1_ps(p_wb / 2));
+    const __m128 limit = _mm_sub_ps(
+        _mm_set1_ps(p_wb / 2),
+        _mm_mul_ps(_mm_set1_ps((p_wb - p_side) / p_wa),
+                   abs4(_mm_sub_ps(p_pa, ca))));
+    const __m128i out = _mm_castps_si128(
+        _mm_cmpgt_ps(abs4(_mm_sub_ps(p_pb, cb)), limit));
+
+    // Cell of the line before, for the lanes outside of the first one.
+    const __m128 off2 = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_xor_si128(s, one)), halfa);
+    const __m128i a2 = floor4(_mm_div_ps(_mm_sub_ps(p_pa, off2), wa));
+
+    p_a = _mm_or_si128(_mm_and_si128(out, a2), _mm_andnot_si128(out, a));
+    p_b = _mm_add_epi32(b, out);
+}
+#endif
+
+namespace tmx {
+    // Conversion kernel of an orientation. (X = staggered along x)
+    template <eOrient O, bool X = false> struct sKernel;
+
+    template <> struct sKernel<eOrient::ortho> {
+        static inline void toPixel(const sMapGeom& p_g, int p_x, int p_y,
+                                   float& p_px, float& p_py) {
+            p_px = p_x * p_g.tilewidth;
+            p_py = p_y * p_g.tileheight;
+        }
+        static inline void toTile(const sMapGeom& p_g, float p_px, float p_py,
+                                  int& p_x, int& p_y) {
+            p_x = (int)std::floor(p_px / p_g.tilewidth);
+            p_y = (int)std::floor(p_py / p_g.tileheight);
+        }
+#ifdef TMX_SIMD_COORDS
+        static inline void toPixel4(const sMapGeom& p_g, __m128i p_x,
+                                    __m128i p_y, __m128& p_px, __m128& p_py) {
+            p_px = _mm_mul_ps(_mm_cvtepi32_ps(p_x),
+                              _mm_set1_ps(p_g.tilewidth));
+            p_py = _mm_mul_ps(_mm_cvtepi32_ps(p_y),
+                              _mm_set1_ps(p_g.tileheight));
+        }
+        static inline void toTile4(const sMapGeom& p_g, __m128 p_px,
+                                   __m128 p_py, __m128i& p_x, __m128i& p_y) {
+            p_x = floor4(_mm_div_ps(p_px, _mm_set1_ps(p_g.tilewidth)));
+            p_y = floor4(_mm_div_ps(p_py, _mm_set1_ps(p_g.tileheight)));
+        }
+#endif
+    };
+
+    // Row 0 of column 0 sits at the top of the map's diamond.
+    template <> struct sKernel<eOrient::iso> {
+        static inline void toPixel(const sMapGeom& p_g, int p_x, int p_y,
+                                   float& p_px, float& p_py) {
+            p_px = (p_x - p_y + (int)p_g.height - 1) * (p_g.tilewidth / 2);
+            p_py = (p_x + p_y) * (p_g.tileheight / 2);
+        }
+        static inline void toTile(const sMapGeom& p_g, float p_px, float p_py,
+                                  int& p_x, int& p_y) {
+            // Relative to the top corner of tile (0, 0), in tile units.
+            const float u = (p_px - p_g.height * (p_g.tilewidth / 2)) /
+                            p_g.tilewidth;
+            const float v = p_py / p_g.tileheight;
+            p_x = (int)std::floor(v + u);
+            p_y = (int)std::floor(v - u);
+        }
+#ifdef TMX_SIMD_COORDS
+        static inline void toPixel4(const sMapGeom& p_g, __m128i p_x,
+                                    __m128i p_y, __m128& p_px, __m128& p_py) {
+            const __m128i col = _mm_add_epi32(
+                _mm_sub_epi32(p_x, p_y), _mm_set1_epi32(p_g.height - 1));
+            p_px = _mm_mul_ps(_mm_cvtepi32_ps(col),
+                              _mm_set1_ps(p_g.tilewidth / 2));
+            p_py = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(p_x, p_y)),
+                              _mm_set1_ps(p_g.tileheight / 2));
+        }
+        static inline void toTile4(const sMapGeom& p_g, __m128 p_px,
+                                   __m128 p_py, __m128i& p_x, __m128i& p_y) {
+            const __m128 u = _mm_div_ps(
+                _mm_sub_ps(p_px, _mm_set1_ps(p_g.height *
+                                             (p_g.tilewidth / 2))),
+                _mm_set1_ps(p_g.tilewidth));
+            const __m128 v = _mm_div_ps(p_py, _mm_set1_ps(p_g.tileheight));
+            p_x = floor4(_mm_add_ps(v, u));
+            p_y = floor4(_mm_sub_ps(v, u));
+        }
+#endif
+    };
+
+    // Staggered & hexagonal maps, hexside being 0 on staggered ones. Rows
+    // are staggered here, the stagger axis is y.
+    template <> struct sKernel<eOrient::stag, false> {
+        static inline float step(const sMapGeom& p_g) {
+            return (p_g.tileheight + p_g.hexside) / 2;
+        }
+        static inline void toPixel(const sMapGeom& p_g, int p_x, int p_y,
+                                   float& p_px, float& p_py) {
+            stagToPixel(p_x, p_y, p_g.tilewidth, step(p_g), p_g.staggereven,
+                        p_px, p_py);
+        }
+        static inline void toTile(const sMapGeom& p_g, float p_px, float p_py,
+                                  int& p_x, int& p_y) {
+            stagToTile(p_px, p_py, p_g.tilewidth, p_g.tileheight, p_g.hexside,
+                       step(p_g), p_g.staggereven, p_x, p_y);
+        }
+#ifdef TMX_SIMD_COORDS
+        static inline void toPixel4(const sMapGeom& p_g, __m128i p_x,
+                                    __m128i p_y, __m128& p_px, __m128& p_py) {
+            stagToPixel4(p_x, p_y, p_g.tilewidth, step(p_g), p_g.staggereven,
+                         p_px, p_py);
+        }
+        static inline void toTile4(const sMapGeom& p_g, __m128 p_px,
+                                   __m128 p_py, __m128i& p_x, __m128i& p_y) {
+            stagToTile4(p_px, p_py, p_g.tilewidth, p_g.tileheight,
+                        p_g.hexside, step(p_g), p_g.staggereven, p_x, p_y);
+        }
+#endif
+    };
+
+    // Columns are staggered, same as above with the axes swapped.
+    template <> struct sKernel<eOrient::stag, true> {
+        static inline float step(const sMapGeom& p_g) {
+            return (p_g.tilewidth + p_g.hexside) / 2;
+        }
+        static inline void toPixel(const sMapGeom& p_g, int p_x, int p_y,
+                                   float& p_px, float& p_py) {
+            stagToPixel(p_y, p_x, p_g.tileheight, step(p_g), p_g.staggereven,
+                        p_py, p_px);
+        }
+        static inline void toTile(const sMapGeom& p_g, float p_px, float p_py,
+                                  int& p_x, int& p_y) {
+            stagToTile(p_py, p_px, p_g.tileheight, p_g.tilewidth, p_g.hexside,
+                       step(p_g), p_g.staggereven, p_y, p_x);
+        }
+#ifdef TMX_SIMD_COORDS
+        static inline void toPixel4(const sMapGeom& p_g, __m128i p_x,
+                                    __m128i p_y, __m128& p_px, __m128& p_py) {
+            stagToPixel4(p_y, p_x, p_g.tileheight, step(p_g), p_g.staggereven,
+                         p_py, p_px);
+        }
+        static inline void toTile4(const sMapGeom& p_g, __m128 p_px,
+                                   __m128 p_py, __m128i& p_x, __m128i& p_y) {
+            stagToTile4(p_py, p_px, p_g.tileheight, p_g.tilewidth,
+                        p_g.hexside, step(p_g), p_g.staggereven, p_y, p_x);
+        }
+#endif
+    };
+
+    /**
+     * Converts tile positions to pixels with a kernel, 4 at a time.
+     *
+     * @param p_g The map's geometry.
+     * @param p_in Tile positions. (x0, y0, x1, y1...)
+     * @param p_n Number of positions.
+     * @param p_out Pixel positions to write to.
+     */
+    template <class K>
+    static void batchToPixel(const sMapGeom& p_g, const int32_t* p_in,
+                             size_t p_n, float* p_out) {
+        size_t i = 0;
+#ifdef TMX_SIMD_COORDS
+        for (; i + 4 <= p_n; i += 4) {
+            // Split the x, y pairs into lanes of x and lanes of y.
+            const __m128 lo = _mm_castsi128_ps(
+                _mm_loadu_si128((const __m128i*)(p_in + 2 * i)));
+            const __m128 hi = _mm_castsi128_ps(
+                _mm_loadu_si128((const __m128i*)(p_in + 2 * i + 4)));
+            const __m128i x = _mm_castps_si128(
+                _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i y = _mm_castps_si128(
+                _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            __m128 px, py;
+            K::toPixel4(p_g, x, y, px, py);
+            _mm_storeu_ps(p_out + 2 * i, _mm_unpacklo_ps(px, py));
+            _mm_storeu_ps(p_out + 2 * i + 4, _mm_unpackhi_ps(px, py));
+        }
+#endif
+        for (; i < p_n; i++)
+            K::toPixel(p_g, p_in[2 * i], p_in[2 * i + 1],
+                       p_out[2 * i], p_out[2 * i + 1]);
+    }
+
+    /**
+     * Converts pixel positions to tiles with a kernel, 4 at a time.
+     *
+     * @param p_g The map's geometry.
+     * @param p_in Pixel positions. (x0, y0, x1, y1...)
+     * @param p_n Number of positions.
+     * @param p_out Tile positions to write to.
+     */
+    template <class K>
+    static void batchToTile(const sMapGeom& p_g, const float* p_in,
+                            size_t p_n, int32_t* p_out) {
+        size_t i = 0;
+#ifdef TMX_SIMD_COORDS
+        for (; i + 4 <= p_n; i += 4) {
+            const __m128 lo = _mm_loadu_ps(p_in + 2 * i);
+            const __m128 hi = _mm_loadu_ps(p_in + 2 * i + 4);
+
+            __m128i x, y;
+            K::toTile4(p_g,
+                       _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)),
+                       _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)),
+                       x, y);
+            _mm_storeu_si128((__m128i*)(p_out + 2 * i),
+                             _mm_unpacklo_epi32(x, y));
+            _mm_storeu_si128((__m128i*)(p_out + 2 * i + 4),
+                             _mm_unpackhi_epi32(x, y));
+        }
+#endif
+        for (; i < p_n; i++) {
+            int x, y;
+            K::toTile(p_g, p_in[2 * i], p_in[2 * i + 1], x, y);
+            p_out[2 * i] = x;
+            p_out[2 * i + 1] = y;
+        }
+    }
+
+    sMapGeom mapGeom(sNode& p_map) {
+        sMapGeom g;
+
+        std::string o = getNodeVar(p_map, "orientation").value;
+        if (o == "isometric") g.orient = eOrient::iso;
+        else if (o == "staggered") g.orient = eOrient::stag;
+        else if (o == "hexagonal") g.orient = eOrient::hex;
+        else g.orient = eOrient::ortho;
+
+        g.width = valInt(getNodeVar(p_map, "width"));
+        g.height = valInt(getNodeVar(p_map, "height"));
+        g.tilewidth = valInt(getNodeVar(p_map, "tilewidth"));
+        g.tileheight = valInt(getNodeVar(p_map, "tileheight"));
+        g.hexside = valInt(getNodeVar(p_map, "hexsidelength"));
+        g.staggerx = (getNodeVar(p_map, "staggeraxis").value == "x");
+        g.staggereven = (getNodeVar(p_map, "staggerindex").value == "even");
+
+        // Only hexagonal maps have sides.
+        if (g.orient != eOrient::hex)
+            g.hexside = 0;
+        return g;
+    }
+
+    void tileToPixel(
+        const sMapGeom& p_geom,
+        int p_x,
+        int p_y,
+        float& p_px,
+        float& p_py
+    ) {
+        switch (p_geom.orient) {
+        case eOrient::ortho:
+            sKernel<eOrient::ortho>::toPixel(p_geom, p_x, p_y, p_px, p_py);
+            break;
+        case eOrient::iso:
+            sKernel<eOrient::iso>::toPixel(p_geom, p_x, p_y, p_px, p_py);
+            break;
+        case eOrient::stag:
+        case eOrient::hex:
+            if (p_geom.staggerx)
+                sKernel<eOrient::stag, true>::toPixel(
+                    p_geom, p_x, p_y, p_px, p_py);
+            else
+                sKernel<eOrient::stag, false>::toPixel(
+                    p_geom, p_x, p_y, p_px, p_py);
+            break;
+        }
+    }
+
+    void pixelToTile(
+        const sMapGeom& p_geom,
+        float p_px,
+        float p_py,
+        int& p_x,
+        int& p_y
+    ) {
+        switch (p_geom.orient) {
+        case eOrient::ortho:
+            sKernel<eOrient::ortho>::toTile(p_geom, p_px, p_py, p_x, p_y);
+            break;
+        case eOrient::iso:
+            sKernel<eOrient::iso>::toTile(p_geom, p_px, p_py, p_x, p_y);
+            break;
+        case eOrient::stag:
+        case eOrient::hex:
+            if (p_geom.staggerx)
+                sKernel<eOrient::stag, true>::toTile(
+                    p_geom, p_px, p_py, p_x, p_y);
+            else
+                sKernel<eOrient::stag, false>::toTile(
+                    p_geom, p_px, p_py, p_x, p_y);
+            break;
+        }
+    }
+
+    void tilesToPixels(
+        const sMapGeom& p_geom,
+        const int32_t* p_tiles,
+        size_t p_count,
+        float* p_out
+    ) {
+        switch (p_geom.orient) {
+        case eOrient::ortho:
+            batchToPixel<sKernel<eOrient::ortho>>(
+                p_geom, p_tiles, p_count, p_out);
+            break;
+        case eOrient::iso:
+            batchToPixel<sKernel<eOrient::iso>>(
+                p_geom, p_tiles, p_count, p_out);
+            break;
+        case eOrient::stag:
+        case eOrient::hex:
+            if (p_geom.staggerx)
+                batchToPixel<sKernel<eOrient::stag, true>>(
+                    p_geom, p_tiles, p_count, p_out);
+            else
+                batchToPixel<sKernel<eOrient::stag, false>>(
+                    p_geom, p_tiles, p_count, p_out);
+            break;
+        }
+    }
+
+    void pixelsToTiles(
+        const sMapGeom& p_geom,
+        const float* p_pixels,
+        size_t p_count,
+        int32_t* p_out
+    ) {
+        switch (p_geom.orient) {
+        case eOrient::ortho:
+            batchToTile<sKernel<eOrient::ortho>>(
+                p_geom, p_pixels, p_count, p_out);
+            break;
+        case eOrient::iso:
+            batchToTile<sKernel<eOrient::iso>>(
+                p_geom, p_pixels, p_count, p_out);
+            break;
+        case eOrient::stag:
+        case eOrient::hex:
+            if (p_geom.staggerx)
+                batchToTile<sKernel<eOrient::stag, true>>(
+                    p_geom, p_pixels, p_count, p_out);
+            else
+                batchToTile<sKernel<eOrient::stag, false>>(
+                    p_geom, p_pixels, p_count, p_out);
+            break;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef LM_TMX_COORDS_H
+#define LM_TMX_COORDS_H
+
+#include <stdint.h>
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Orientation aware conversion between tile and pixel coordinates, covering
+ * orthogonal, isometric, staggered and hexagonal maps.
+ *
+ * Each orientation has its own compile-time kernel. The batch functions pick
+ * the kernel once per call and convert 4 points at a time where the target
+ * supports it. (SSE2)
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Map geometry structure.
+    struct sMapGeom {
+        eOrient orient;
+        unsigned int width; //@- Map width in tiles.
+        unsigned int height; //@- Map height in tiles.
+        float tilewidth;
+        float tileheight;
+        float hexside; //@- Length of a hexagon's flat side. (hexsidelength)
+        bool staggerx; //@- Staggered along x instead of y. (staggeraxis)
+        bool staggereven; //@- Even instead of odd rows/columns are shifted.
+    };
+
+    /**
+     * Reads the geometry attributes of a map.
+     *
+     * @param p_map The root <map> node.
+     * @returns [sMapGeom] The map's geometry.
+     */
+    sMapGeom mapGeom(sNode& p_map);
+
+    /**
+     * Get the pixel position of the top-left corner of a tile's cell. (the
+     * bounding box of the diamond/hexagon on non-orthogonal maps)
+     *
+     * @param p_geom The map's geometry.
+     * @param p_x Column of the tile.
+     * @param p_y Row of the tile.
+     * @param p_px Pixel x coordinate to write to.
+     * @param p_py Pixel y coordinate to write to.
+     */
+    void tileToPixel(
+        const sMapGeom& p_geom,
+        int p_x,
+        int p_y,
+        float& p_px,
+        float& p_py
+    );
+
+    /**
+     * Get the tile whose cell shape (rectangle, diamond or hexagon) holds a
+     * pixel position. Positions outside of the map give tiles outside of it.
+     *
+     * @param p_geom The map's geometry.
+     * @param p_px Pixel x coordinate.
+     * @param p_py Pixel y coordinate.
+     * @param p_x Column of the tile to write to.
+     * @param p_y Row of the tile to write to.
+     */
+    void pixelToTile(
+        const sMapGeom& p_geom,
+        float p_px,
+        float p_py,
+        int& p_x,
+        int& p_y
+    );
+
+    /**
+     * Converts an array of tile positions with tileToPixel.
+     *
+     * @param p_geom The map's geometry.
+     * @param p_tiles Tile positions. (x0, y0, x1, y1...)
+     * @param p_count Number of positions.
+     * @param p_out Pixel positions to write to. (x0, y0, x1, y1...)
+     */
+    void tilesToPixels(
+        const sMapGeom& p_geom,
+        const int32_t* p_tiles,
+        size_t p_count,
+        float* p_out
+    );
+
+    /**
+     * Converts an array of pixel positions with pixelToTile.
+     *
+     * @param p_geom The map's geometry.
+     * @param p_pixels Pixel positions. (x0, y0, x1, y1...)
+     * @param p_count Number of positions.
+     * @param p_out Tile positions to write to. (x0, y0, x1, y1...)
+     */
+    void pixelsToTiles(
+        const sMapGeom& p_geom,
+        const float* p_pixels,
+        size_t p_count,
+        int32_t* p_out
+    );
+}
+
+#endif
@@ -1,4 +1,11 @@
+#include <stdexcept>
+
 #include "tmx_core.h"
+#include "tmx_layer.h"
+#include "tmx_utils.h"
+#include "tmx_geometry.h"
+#include "tmx_tileset.h"
+#include "tmx_decode.h"
 using namespace tmx;
 
 /**============================================================================
@@ -54,6 +61,36 @@ std::string tmxAttrDefault(eTag p_tag, str_p p_attr, sNode* p_map = nullptr) {
     return TMX_UNDEFINED_ATTRIBUTE;
 }
 
+/**
+ * Checks whether the given tag is one of the map's layer tags.
+ *
+ * @param p_tag The TMX tag to evaluate.
+ * @returns [bool] Whether or not the tag is a layer tag.
+ */
+bool isLayerTag(eTag p_tag) {
+    return (p_tag == eTag::layer ||
+            p_tag == eTag::objectgroup ||
+            p_tag == eTag::imagelayer);
+}
+
+/**
+ * Checks whether the values of an attribute repeat across nodes & maps,
+ * such values are interned rather than copied into every node.
+ *
+ * @param p_attr The name of the attribute.
+ * @returns [bool] Whether or not the attribute's values are interned.
+ */
+bool isSharedAttr(str_p p_attr) {
+    static const char* shared[] = {
+        "type", "class", "source", "orientation", "renderorder",
+        "staggeraxis", "staggerindex", "draworder", "encoding", "compression"
+    };
+    for (unsigned int i = 0; i < sizeof(shared) / sizeof(*shared); i++)
+        if (p_attr == shared[i])
+            return true;
+    return false;
+}
+
 /**============================================================================
  *  X M L  H E L P E R  F U N C T I O N S
  ============================================================================*/
@@ -184,12 +221,20 @@ bool xmlLoadDataCSV(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
             t = t->next_sibling("tile")
         ) {
             std::string gid = xmlEvalAttr(t, "gid");
-            // Ignore if no gid found.
+            // A tile without a gid is an empty one.
             if (gid == TMX_UNDEFINED_ATTRIBUTE)
-                continue;
+                gid = "0";
             csv += gid + ((t->next_sibling("tile")) ? "," : "");
         }
     }
+    // Base64 data is kept as is, it's decoded along with the layer.
+    else if (enc == "base64") {
+        eComp c;
+        if (!compressionOf(comp, c))
+            return false;
+        p_tnode.data = new sData(mkData(p_xnode->value(), eEnc::base64, c));
+        return true;
+    }
 
     // Make sure an empty string isn't being loaded.
     if (csv == "")
@@ -199,15 +244,97 @@ bool xmlLoadDataCSV(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
     return true;
 }
 
+/**
+ * Decodes a layer's gids straight from its XML data node into the layer's
+ * tile storage. The data's text isn't kept. When the map's tilesets all fit
+ * in 16-bit packed gids, the data is decoded in that form and becomes the
+ * layer's dense16 storage without a 32-bit copy.
+ *
+ * @param p_xnode XML data node of the layer.
+ * @param p_layer TMX layer node, holding the layer's size.
+ * @param p_tnode TMX data node to load the tiles into.
+ * @param p_enc Encoding of the data.
+ * @param p_comp Compression of the data.
+ * @param p_maxgid Highest gid of the map's tilesets, 0 if unknown.
+ * @returns [bool] Whether or not the data was decoded, layers without a...
+ * ...size or with an unknown encoding are left without tiles.
+ * @throws [std::runtime_error] If the data holds fewer gids than the...
+ * ...layer's tiles, or fails to inflate.
+ */
+
+bool xmlLoadLayerData(
+    rapidxml::xml_node<>* p_xnode,
+    sNode& p_layer,
+    sNode& p_tnode,
+    str_p p_enc,
+    str_p p_comp,
+    uint32_t p_maxgid
+) {
+    sVal w = getNodeVar(p_layer, "width");
+    sVal h = getNodeVar(p_layer, "height");
+    if (w.type == eType::error || h.type == eType::error)
+        return false;
+
+    // Pick the layer's decoders once, rather than per tile.
+    eEnc e;
+    eComp c;
+    if (!encodingOf(p_enc, e) || !compressionOf(p_comp, c))
+        return false;
+    const gidDecoder decode16 = findDecoder(e, c, 16);
+    const gidDecoder decode32 = findDecoder(e, c);
+    if (decode16 == nullptr || decode32 == nullptr)
+        return false;
+    p_tnode.data = new sData(mkData("", e, c));
+
+    const unsigned int width = std::stoul(w.value);
+    const unsigned int height = std::stoul(h.value);
+    const size_t n = (size_t)width * height;
+    const sDecodeSrc src = { p_xnode->value(), p_xnode->value_size(), p_xnode };
+
+    // Infinite maps keep their tiles in <chunk> nodes, which aren't decoded.
+    if (p_xnode->first_node("chunk") != nullptr) {
+        std::vector<uint32_t> gids(n, 0);
+        p_tnode.data->tiles = new tilelayer(gids.data(), width, height,
+                                            p_maxgid);
+        return true;
+    }
+
+    // Packed gids hold the tilesets' gids, data with gids past them (or the
+    // hexagonal rotation flag) is decoded again with 32-bit gids.
+    if (p_maxgid <= TMX_DENSE16_MAX) {
+        std::vector<uint16_t> packed(n, 0);
+        uint32_t lost = 0;
+        if (decode16(src, { packed.data(), nullptr, &lost, n }) != n)
+            throw std::runtime_error("Corrupt layer data");
+        if (lost == 0) {
+            p_tnode.data->tiles = new tilelayer(std::move(packed), width,
+                                                height, p_maxgid);
+            return true;
+        }
+    }
+
+    std::vector<uint32_t> gids(n, 0);
+    if (decode32(src, { gids.data(), nullptr, nullptr, n }) != n)
+        throw std::runtime_error("Corrupt layer data");
+    p_tnode.data->tiles = new tilelayer(gids.data(), width, height, p_maxgid);
+    return true;
+}
+
 /**
  * Load raw data into TMX node.
  *
  * @param p_xnode XML node of TMX node used to find the data XML node.
  * @param p_tnode TMX node to load the data into.
+ * @param p_maxgid Highest gid of the map's tilesets, layers only...
+ * ...defaults to unknown. (0)
  * @returns [bool] Whether or not the data was loaded successfully.
  */
 
-bool xmlLoadNodeData(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
+bool xmlLoadNodeData(
+    rapidxml::xml_node<>* p_xnode,
+    sNode& p_tnode,
+    uint32_t p_maxgid = 0
+) {
     // Check if the XML node is valid.
     if (p_xnode == nullptr)
         return false;
@@ -236,10 +363,13 @@ bool xmlLoadNodeData(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
     setNodeVar(*n, mkVar("encoding", encoding, eType::str));
     setNodeVar(*n, mkVar("compression", compression, eType::str));
 
-    if(!xmlLoadDataCSV(data, *n))
-        return false;
+    // Layers only keep their decoded tiles.
+    if (p_tnode.tag == eTag::layer)
+        return xmlLoadLayerData(
+            data, p_tnode, *n, encoding, compression, p_maxgid
+        );
 
-    return true;
+    return xmlLoadDataCSV(data, *n);
 }
 
 /**
@@ -247,10 +377,15 @@ bool xmlLoadNodeData(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
  *
  * @param p_xnode XML node of TMX node used to locate child TMX nodes.
  * @param p_tnode TMX node to load the child TMX nodes into.
+ * @param p_ctl Load control structure to report to. Defaults to none.
  * @returns [bool] Whether or not the child nodes were loaded successfully,
  */
 
-bool xmlLoadChildNodes(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
+bool xmlLoadChildNodes(
+    rapidxml::xml_node<>* p_xnode,
+    sNode& p_tnode,
+    sLoadCtl* p_ctl = nullptr
+) {
     // Checks if the XML node is valid.
     if (p_xnode == nullptr)
         return false;
@@ -359,20 +494,37 @@ bool xmlLoadChildNodes(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
     // TMX <tileset> > <tile> attributes...
     std::vector<sVal> d_tsta{
         { "id", eType::whole },
+        { "terrain", eType::str },
         { "probability", eType::dec }
     };
 
+    // TMX <terrain> attributes...
+    std::vector<sVal> d_tea{
+        { "name", eType::str },
+        { "tile", eType::whole }
+    };
+
     // Load all of the child nodes into the given TMX node.
     for (rapidxml::xml_node<>* xmlnode = p_xnode->first_node();
         xmlnode;
         xmlnode = xmlnode->next_sibling()
     ) {
+        // Abort if the load has been cancelled.
+        if (p_ctl != nullptr && p_ctl->cancel.load())
+            return false;
+
         // Get the TMX tag of the XML node.
         eTag tag = xmlEvalTag(xmlnode);
 
-        // Ignore it if it's an <ignore> tag.
-        if (tag == eTag::ignore)
+        // Ignore it if it's an <ignore> tag. <terraintypes> only wraps the
+        // tileset's <terrain> nodes, which are loaded into the tileset.
+        if (tag == eTag::ignore) {
+            if (p_tnode.tag == eTag::tileset &&
+                std::string(xmlnode->name()) == "terraintypes" &&
+                !xmlLoadChildNodes(xmlnode, p_tnode, p_ctl))
+                return false;
             continue;
+        }
 
         // Determine which attributes to load based on the node's tag.
         std::vector<sVal>* attrs;
@@ -387,6 +539,7 @@ bool xmlLoadChildNodes(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
         case eTag::ellipse: attrs = &d_ea; break;
         case eTag::polygon: attrs = &d_pa; break;
         case eTag::polyline: attrs = &d_pa; break;
+        case eTag::terrain: attrs = &d_tea; break;
         case eTag::tile:
             if (p_tnode.tag == eTag::layer) attrs = &d_lta;
             else if (p_tnode.tag == eTag::tileset) attrs = &d_tsta;
@@ -424,15 +577,34 @@ bool xmlLoadChildNodes(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
                 );
         }
 
-        // Load the node's data.
-        xmlLoadNodeData(xmlnode, *tmxnode);
+        // Load the node's data. Layers are sized to the gids of the map's
+        // tilesets, which come before them.
+        if (tag == eTag::layer && p_tnode.tag == eTag::map)
+            xmlLoadNodeData(xmlnode, *tmxnode, maxGid(loadTilesets(p_tnode)));
+        else
+            xmlLoadNodeData(xmlnode, *tmxnode);
         // Load the node's properties.
         xmlLoadNodeProps(xmlnode, *tmxnode);
 
         // Load the node's child nodes.
         if (xmlnode->first_node() != nullptr)
-            if (!xmlLoadChildNodes(xmlnode, *tmxnode))
+            if (!xmlLoadChildNodes(xmlnode, *tmxnode, p_ctl))
                 return false;
+
+        // Report progress once a layer of the map has been loaded. The
+        // layer ends where the next element starts, the last one with the
+        // file.
+        if (p_ctl != nullptr && p_tnode.tag == eTag::map && isLayerTag(tag)) {
+            rapidxml::xml_node<>* next = xmlnode->next_sibling();
+            while (next != nullptr && next->type() != rapidxml::node_element)
+                next = next->next_sibling();
+            p_ctl->bytes = (next != nullptr) ?
+                           (size_t)(next->name() - p_ctl->base) :
+                           p_ctl->bytestotal.load();
+            p_ctl->layers++;
+            if (p_ctl->progress)
+                p_ctl->progress(p_ctl->bytes, p_ctl->layers);
+        }
     }
     return true;
 }
@@ -443,11 +615,13 @@ bool xmlLoadChildNodes(rapidxml::xml_node<>* p_xnode, sNode& p_tnode) {
 
 namespace tmx {
     tmx::sNamedVal mkVar(str_p p_name, str_p p_value, eType p_type) {
-        return { p_name,{ p_value, p_type } };
+        if (isSharedAttr(p_name))
+            return { p_name, { istr(p_value), p_type } };
+        return { p_name, { p_value, p_type } };
     }
 
     tmx::sData mkData(str_p p_value, eEnc p_enc, eComp p_comp) {
-        return { p_value, p_enc, p_comp };
+        return { p_value, p_enc, p_comp, nullptr, nullptr, TMX_GEOM_NONE };
     }
 
     tmx::sNode mkNode(eTag p_tag, const sData& p_data) {
@@ -473,7 +647,7 @@ namespace tmx {
 
     bool setNodeVar(sNode& p_node, const sNamedVal& p_var, bool p_prop) {
         // Deliminates whether or not the variable is a property.
-        std::string n = ((p_prop) ? "\'" : "") + p_var.name;
+        const istr n = (p_prop) ? istr("\'" + p_var.name.str()) : p_var.name;
 
         // Initializes the TMX node's variable list if undefined.
         if (p_node.vars == nullptr) {
@@ -501,13 +675,19 @@ namespace tmx {
         return true;
     }
 
-    sVal getNodeVar(sNode& p_node, str_p p_name, bool p_prop) {
+    sVal getNodeVar(const sNode& p_node, str_p p_name, bool p_prop) {
         // Makes sure the TMX node's variable set is initialized
         if(p_node.vars == nullptr)
             return {"!Node sets uninitialized", eType::error};
 
         // Deliminates whether or not the requested variable is a property.
-        std::string n = ((p_prop) ? "\'" : "") + p_name;
+        // A name that was never interned can't name any variable.
+        istr n;
+        if (!istr::find(((p_prop) ? "\'" : "") + p_name, n))
+            return {
+                "!Reached end of node sets without finding specified set.",
+                eType::error
+            };
 
         // Looks for requested variable to return.
         for(auto it = p_node.vars; it; it = it->next())
@@ -521,7 +701,96 @@ namespace tmx {
         };
     }
 
-    sNode load(str_p p_path) {
+    long valInt(const sVal& p_val, long p_default) {
+        if (p_val.type == eType::error)
+            return p_default;
+        return strtol(p_val.value.c_str(), nullptr, 10);
+    }
+
+    double valDec(const sVal& p_val, double p_default) {
+        if (p_val.type == eType::error)
+            return p_default;
+        return strtod(p_val.value.c_str(), nullptr);
+    }
+
+    void freeNode(sNode& p_node) {
+        // Free the child nodes depth first.
+        for (auto it = p_node.nodes; it;) {
+            auto next = it->next();
+            freeNode(*it->valptr());
+            delete it;
+            it = next;
+        }
+
+        // Free the variable list.
+        for (auto it = p_node.vars; it;) {
+            auto next = it->next();
+            delete it;
+            it = next;
+        }
+
+        if (p_node.data != nullptr) {
+            delete p_node.data->tiles;
+            delete p_node.data->geom;
+        }
+        delete p_node.data;
+
+        p_node.nodes = nullptr;
+        p_node.vars = nullptr;
+        p_node.data = nullptr;
+    }
+
+    sNode cloneNode(const sNode& p_node) {
+        sNode n = { p_node.tag, nullptr, nullptr, nullptr };
+
+        if (p_node.data != nullptr) {
+            n.data = new sData(*p_node.data);
+            if (p_node.data->tiles != nullptr)
+                n.data->tiles = new tilelayer(*p_node.data->tiles);
+            if (p_node.data->geom != nullptr)
+                n.data->geom = new sGeometry(*p_node.data->geom);
+        }
+
+        // Copy the lists in order, keeping track of their last instance.
+        TList<sNamedVal>* var = nullptr;
+        for (auto it = p_node.vars; it; it = it->next())
+            var = (var == nullptr) ?
+                  (n.vars = new TList<sNamedVal>(*it->valptr())) :
+                  var->append(*it->valptr());
+
+        TList<sNode>* child = nullptr;
+        for (auto it = p_node.nodes; it; it = it->next())
+            child = (child == nullptr) ?
+                    (n.nodes = new TList<sNode>(cloneNode(*it->valptr()))) :
+                    child->append(cloneNode(*it->valptr()));
+
+        return n;
+    }
+
+    size_t nodeMemory(sNode& p_node) {
+        size_t bytes = 0;
+
+        for (auto it = p_node.vars; it; it = it->next())
+            bytes += sizeof(*it) + it->valptr()->myvalue.value.memory();
+
+        if (p_node.data != nullptr) {
+            bytes += sizeof(sData) + p_node.data->value.capacity();
+            if (p_node.data->tiles != nullptr)
+                bytes += sizeof(tilelayer) + p_node.data->tiles->memory();
+            const sGeometry* g = p_node.data->geom;
+            if (g != nullptr)
+                bytes += sizeof(sGeometry) +
+                         g->objects.capacity() * sizeof(sObjGeom) +
+                         g->points.capacity() * sizeof(float) +
+                         g->indices.capacity() * sizeof(uint32_t);
+        }
+
+        for (auto it = p_node.nodes; it; it = it->next())
+            bytes += sizeof(*it) + nodeMemory(*it->valptr());
+        return bytes;
+    }
+
+    sNode load(str_p p_path, sLoadCtl* p_ctl) {
         // Load the TMX map from given file path.
         rapidxml::file<> file(p_path.c_str());
         rapidxml::xml_document<> document;
@@ -532,6 +801,24 @@ namespace tmx {
         rapidxml::xml_node<>* map_node = document.first_node("map");
         sNode map = mkNode(eTag::map);
 
+        if (p_ctl != nullptr) {
+            if (p_ctl->cancel.load())
+                return mkNode(eTag::ignore);
+
+            // Count the map's layers so progress can be reported against it.
+            unsigned int layers = 0;
+            for (rapidxml::xml_node<>* n = map_node->first_node();
+                n;
+                n = n->next_sibling()
+            )
+                if (isLayerTag(xmlEvalTag(n)))
+                    layers++;
+
+            p_ctl->base = file.data();
+            p_ctl->bytestotal = file.size();
+            p_ctl->layerstotal = layers;
+        }
+
         // Defining attributes to look for in the <map> tag.
         std::vector<sVal> d_ma {
             {"version", eType::str},
@@ -572,7 +859,29 @@ namespace tmx {
         // Load <map> properties.
         xmlLoadNodeProps(map_node, map);
         // Load <map> child nodes.
-        xmlLoadChildNodes(map_node, map);
+        try {
+            xmlLoadChildNodes(map_node, map, p_ctl);
+        } catch (const std::runtime_error&) {
+            // Corrupt layer data, nothing of the map is kept.
+            freeNode(map);
+            throw std::runtime_error(
+                "Can't decode the layer data of " + p_path
+            );
+        }
+
+        if (p_ctl != nullptr) {
+            // Release the partially built map if the load was cancelled.
+            if (p_ctl->cancel.load()) {
+                freeNode(map);
+                return mkNode(eTag::ignore);
+            }
+
+            if (p_ctl->geometry)
+                buildGeometry(map);
+
+            p_ctl->base = nullptr;
+            p_ctl->bytes = p_ctl->bytestotal.load();
+        }
 
         return map;
     }
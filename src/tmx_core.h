@@ -20,14 +20,20 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <functional>
 
 #include "rapidxml.hpp"
 #include "rapidxml_utils.hpp"
 #include "tlist.hpp"
+#include "tmx_intern.h"
 
 #define TMX_UNDEFINED_ATTRIBUTE "\""
 
 namespace tmx {
+    class tilelayer;
+    struct sGeometry;
+
     typedef const std::string& str_p; //@- String argument type
 
     // Available tags in the TMX standard
@@ -47,12 +53,22 @@ namespace tmx {
     // Compression types of raw data.
     enum eComp { none, gzip, zlib };
 
-    // Value structure.
-    struct sVal { std::string value; eType type; };
-    // Variable structure.
-    struct sNamedVal { std::string name; sVal myvalue; };
-    // Raw data structure.
-    struct sData { std::string value; eEnc enc; eComp comp; };
+    // Value structure. (value = interned for attributes whose values repeat,
+    // such as type & source, owned otherwise, see tmx_intern.h)
+    struct sVal { vstr value; eType type; };
+    // Variable structure. (name = interned)
+    struct sNamedVal { istr name; sVal myvalue; };
+    // Raw data structure. (tiles = decoded layer gids, in which case value
+    // is left empty, geom = object group geometry, if any, geomindex = an
+    // object's entry in its group's geometry, see tmx_geometry.h)
+    struct sData {
+        std::string value;
+        eEnc enc;
+        eComp comp;
+        tilelayer* tiles;
+        sGeometry* geom;
+        uint32_t geomindex;
+    };
 
     // Base node structure.
     struct sNode {
@@ -62,8 +78,25 @@ namespace tmx {
         sData* data;
     };
 
+    // Load control structure, shared between the loader and its caller.
+    struct sLoadCtl {
+        std::atomic<size_t> bytes; //@- Bytes of the TMX file processed.
+        std::atomic<size_t> bytestotal; //@- Size of the TMX file in bytes.
+        std::atomic<unsigned int> layers; //@- Layers processed.
+        std::atomic<unsigned int> layerstotal; //@- Layers in the TMX file.
+        std::atomic<bool> cancel; //@- Set to abort the load.
+        //@- Called each time a layer finishes loading. (bytes, layers)
+        std::function<void(size_t, unsigned int)> progress;
+        const char* base; //@- Start of the XML buffer. (set by load)
+        bool geometry; //@- Build the object geometry. (see tmx_geometry.h)
+
+        sLoadCtl() : bytes(0), bytestotal(0), layers(0), layerstotal(0),
+                     cancel(false), base(nullptr), geometry(false) {}
+    };
+
     /**
-    * Builds a variable to assign to a node.
+    * Builds a variable to assign to a node. Values of attributes that
+    * repeat across maps, (type, source...) are interned.
     *
     * @param p_name The name of the variable to build.
     * @param p_value The value the new variable should hold.
@@ -134,15 +167,67 @@ namespace tmx {
     * @param p_prop Specifies whether this variable is a property or not.
     * @returns [sVal] The value of the variable.
     */
-    sVal getNodeVar(sNode& p_node, str_p p_name, bool p_prop = false);
+    sVal getNodeVar(const sNode& p_node, str_p p_name, bool p_prop = false);
+
+    /**
+    * Converts a variable's value to an integer.
+    *
+    * @param p_val The value to convert.
+    * @param p_default Returned if the value is an error. Defaults to 0.
+    * @returns [long] The value as an integer.
+    */
+    long valInt(const sVal& p_val, long p_default = 0);
+
+    /**
+    * Converts a variable's value to a decimal.
+    *
+    * @param p_val The value to convert.
+    * @param p_default Returned if the value is an error. Defaults to 0.
+    * @returns [double] The value as a decimal.
+    */
+    double valDec(const sVal& p_val, double p_default = 0);
+
+    /**
+    * Releases all memory owned by the given node and its child nodes. The
+    * node is left with its variable, child node and data pointers undefined.
+    *
+    * @param p_node The sNode to free.
+    */
+    void freeNode(sNode& p_node);
+
+    /**
+    * Deep copies a node and its child nodes, including decoded tiles.
+    *
+    * @param p_node The sNode to copy.
+    * @returns [sNode] The copy, free it with freeNode.
+    */
+    sNode cloneNode(const sNode& p_node);
+
+    /**
+    * Estimates the memory owned by the given node and its child nodes.
+    * Interned names & values are shared, see internStats instead.
+    *
+    * @param p_node The sNode to measure.
+    * @returns [size_t] Approximate size in bytes.
+    */
+    size_t nodeMemory(sNode& p_node);
 
     /**
     * Attempts to load the TMX map file at the given file path.
     *
+    * If a load control structure is given, the loader reports its progress
+    * through it and polls its cancel flag between nodes. A cancelled load
+    * frees everything built so far and returns an <ignore> node.
+    *
+    * Layer data that is truncated or fails to decompress frees the map and
+    * throws std::runtime_error, as does a missing file. Layers without data,
+    * size or a known encoding load without tiles.
+    *
     * @param p_path The path to the TMX map file.
+    * @param p_ctl Load control structure. Defaults to none.
     * @returns [sNode] The first node in the generated TMX structure.
     */
-    sNode load(str_p p_path);
+    sNode load(str_p p_path, sLoadCtl* p_ctl = nullptr);
 }
 
 #endif
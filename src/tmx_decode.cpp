@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+
+#include "tmx_decode.h"
+#include "tmx_layer.h"
+#include "tmx_utils.h"
+
+/**
+ * Check whether the given character is a decimal digit.
+ *
+ * @param p_c Character to check.
+ * @returns [bool] Whether or not the character is a digit.
+ */
+static inline bool isDigit(char p_c) {
+    return (unsigned char)(p_c - '0') < 10;
+}
+
+/** @returns [uint32_t] Little-endian 32-bit value at the given address. */
+static inline uint32_t le32(const uint8_t* p_at) {
+    return p_at[0] | (p_at[1] << 8) | (p_at[2] << 16) |
+           ((uint32_t)p_at[3] << 24);
+}
+
+/**
+ * @returns [const uint8_t*] Value of each character in the base64 set,
+ * 64 for the characters outside of it. (whitespace, padding...)
+ */
+static const uint8_t* base64Table() {
+    static uint8_t table[256];
+    static const bool ready = []() {
+        const char* set =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (unsigned int i = 0; i < 256; i++)
+            table[i] = 64;
+        for (unsigned int i = 0; i < 64; i++)
+            table[(uint8_t)set[i]] = i;
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+/**
+ * Gather the next block of base64 digits of a text, dropping everything
+ * else.
+ *
+ * @param p_raw The text.
+ * @param p_len Length of the text.
+ * @param p_at Position in the text, moved past the block.
+ * @param p_out Array of TMX_DECODE_CHUNK digits to write to.
+ * @returns [size_t] Number of digits written.
+ */
+static inline size_t gather64(const char* p_raw, size_t p_len, size_t& p_at,
+                              uint8_t* p_out) {
+    const uint8_t* table = base64Table();
+    size_t m = 0;
+    for (; p_at < p_len && m < TMX_DECODE_CHUNK; p_at++) {
+        p_out[m] = table[(uint8_t)p_raw[p_at]];
+        m += (p_out[m] < 64);
+    }
+    return m;
+}
+
+/**
+ * Decode up to 16 base64 digit values, 4 digits = 3 bytes.
+ *
+ * @param p_digits Digit values.
+ * @param p_count Number of digits.
+ * @param p_out Array of at least 12 bytes to write to.
+ * @returns [size_t] Number of bytes written.
+ */
+static inline size_t decode64(const uint8_t* p_digits, size_t p_count,
+                              uint8_t* p_out) {
+    uint8_t d[16] = { 0 };
+    for (size_t i = 0; i < p_count; i++)
+        d[i] = p_digits[i];
+    for (unsigned int k = 0; k < 4; k++) {
+        const uint32_t w = (d[4 * k] << 18) | (d[4 * k + 1] << 12) |
+                           (d[4 * k + 2] << 6) | d[4 * k + 3];
+        p_out[3 * k] = (uint8_t)(w >> 16);
+        p_out[3 * k + 1] = (uint8_t)(w >> 8);
+        p_out[3 * k + 2] = (uint8_t)w;
+    }
+    return p_count * 6 / 8;
+}
+
+namespace tmx {
+    // Output stage, stores gids in the destination's layout.
+    template<typename T, bool Split> struct sStore;
+
+    template<> struct sStore<uint32_t, false> {
+        explicit sStore(const sDecodeDst& p_d)
+            : gids((uint32_t*)p_d.gids) {}
+
+        inline void put(size_t p_i, uint32_t p_gid) {
+            gids[p_i] = p_gid;
+        }
+
+        uint32_t* gids;
+    };
+
+    template<> struct sStore<uint32_t, true> {
+        explicit sStore(const sDecodeDst& p_d)
+            : gids((uint32_t*)p_d.gids), flags(p_d.flags) {}
+
+        inline void put(size_t p_i, uint32_t p_gid) {
+            gids[p_i] = p_gid & TMX_GID_MASK;
+            flags[p_i] = (uint8_t)(p_gid >> 29);
+        }
+
+        uint32_t* gids;
+        uint8_t* flags;
+    };
+
+    // The gid bits 16-bit layouts drop are gathered locally, then reported
+    // once.
+    struct sLost {
+        explicit sLost(const sDecodeDst& p_d) : out(p_d.lost), lost(0) {}
+        ~sLost() { *out |= lost; }
+
+        uint32_t* out;
+        uint32_t lost;
+    };
+
+    template<> struct sStore<uint16_t, false> : sLost {
+        explicit sStore(const sDecodeDst& p_d)
+            : sLost(p_d), gids((uint16_t*)p_d.gids) {}
+
+        inline void put(size_t p_i, uint32_t p_gid) {
+            gids[p_i] = (uint16_t)(
+                (p_gid & TMX_DENSE16_MAX) | ((p_gid >> 16) & 0xE000u));
+            lost |= p_gid & (TMX_GID_MASK & ~TMX_DENSE16_MAX);
+        }
+
+        uint16_t* gids;
+    };
+
+    template<> struct sStore<uint16_t, true> : sLost {
+        explicit sStore(const sDecodeDst& p_d)
+            : sLost(p_d), gids((uint16_t*)p_d.gids), flags(p_d.flags) {}
+
+        inline void put(size_t p_i, uint32_t p_gid) {
+            gids[p_i] = (uint16_t)p_gid;
+            flags[p_i] = (uint8_t)(p_gid >> 29);
+            lost |= p_gid & (TMX_GID_MASK & ~0xFFFFu);
+        }
+
+        uint16_t* gids;
+        uint8_t* flags;
+    };
+
+    // Input stages, one per encoding & compression, each feeding an output
+    // stage S built on the destination.
+    template<eEnc E, eComp C> struct sPipe;
+
+    template<> struct sPipe<eEnc::csv, eComp::none> {
+        template<class S>
+        static size_t run(const sDecodeSrc& p_src, const sDecodeDst& p_dst) {
+            S out(p_dst);
+            uint32_t block[TMX_DECODE_CHUNK / 2 + 1];
+            size_t n = 0, i = 0;
+            while (i < p_src.len && n < p_dst.count) {
+                // Cut the block between two numbers.
+                size_t end = std::min(p_src.len, i + TMX_DECODE_CHUNK);
+                while (end < p_src.len && isDigit(p_src.raw[end]) &&
+                       isDigit(p_src.raw[end - 1]))
+                    end++;
+
+                const size_t k = parseGids(
+                    p_src.raw + i, end - i, block,
+                    std::min<size_t>(TMX_DECODE_CHUNK / 2 + 1,
+                                     p_dst.count - n)
+                );
+                for (size_t j = 0; j < k; j++)
+                    out.put(n + j, block[j]);
+                n += k;
+                i = end;
+            }
+            return n;
+        }
+    };
+
+    template<> struct sPipe<eEnc::xml, eComp::none> {
+        template<class S>
+        static size_t run(const sDecodeSrc& p_src, const sDecodeDst& p_dst) {
+            S out(p_dst);
+            size_t n = 0;
+            rapidxml::xml_node<>* t =
+                p_src.node ? p_src.node->first_node("tile") : nullptr;
+            for (; t && n < p_dst.count; t = t->next_sibling("tile")) {
+                // A <tile> without a gid is an empty tile.
+                rapidxml::xml_attribute<>* gid = t->first_attribute("gid");
+                out.put(n++, gid ? strtoul(gid->value(), nullptr, 10) : 0);
+            }
+            return n;
+        }
+    };
+
+    template<> struct sPipe<eEnc::base64, eComp::none> {
+        template<class S>
+        static size_t run(const sDecodeSrc& p_src, const sDecodeDst& p_dst) {
+            S out(p_dst);
+            uint8_t digits[TMX_DECODE_CHUNK];
+            uint8_t bytes[12];
+            size_t n = 0, i = 0;
+            while (i < p_src.len && n < p_dst.count) {
+                const size_t m = gather64(p_src.raw, p_src.len, i, digits);
+
+                // 16 digits = 12 bytes = 3 little-endian gids.
+                for (size_t j = 0; j < m && n < p_dst.count; j += 16) {
+                    const size_t q = std::min<size_t>(16, m - j);
+                    const size_t g = decode64(digits + j, q, bytes) / 4;
+                    if (g == 3 && n + 3 <= p_dst.count) {
+                        out.put(n, le32(bytes));
+                        out.put(n + 1, le32(bytes + 4));
+                        out.put(n + 2, le32(bytes + 8));
+                        n += 3;
+                        continue;
+                    }
+                    for (size_t k = 0; k < g && n < p_dst.count; k++)
+                        out.put(n++, le32(bytes + 4 * k));
+                }
+            }
+            return n;
+        }
+    };
+
+    // Decompression stage of compressed base64 data.
+    template<eComp C> struct sInflate;
+
+    template<> struct sInflate<eComp::zlib> {
+        static inline size_t run(const char* p_raw, size_t p_len,
+                                 char* p_out, size_t p_max) {
+            return zlib_decompress(p_raw, p_len, p_out, p_max);
+        }
+    };
+
+    template<> struct sInflate<eComp::gzip> {
+        static inline size_t run(const char* p_raw, size_t p_len,
+                                 char* p_out, size_t p_max) {
+            return gzip_decompress(p_raw, p_len, p_out, p_max);
+        }
+    };
+
+    template<eComp C> struct sPipe<eEnc::base64, C> {
+        template<class S>
+        static size_t run(const sDecodeSrc& p_src, const sDecodeDst& p_dst) {
+            // Not fused like the others: the whole stream is decoded from
+            // base64, then inflated, then its gids are stored.
+            std::vector<char> packed((p_src.len / 4 + 1) * 3 + 12);
+            uint8_t digits[TMX_DECODE_CHUNK];
+            size_t len = 0, i = 0;
+            while (i < p_src.len) {
+                const size_t m = gather64(p_src.raw, p_src.len, i, digits);
+                for (size_t j = 0; j < m; j += 16)
+                    len += decode64(digits + j, std::min<size_t>(16, m - j),
+                                    (uint8_t*)packed.data() + len);
+            }
+
+            std::vector<char> bytes(p_dst.count * 4);
+            const size_t n = sInflate<C>::run(packed.data(), len,
+                                              bytes.data(), bytes.size()) / 4;
+            const uint8_t* b = (const uint8_t*)bytes.data();
+            S out(p_dst);
+            for (size_t k = 0; k < n; k++)
+                out.put(k, le32(b + 4 * k));
+            return n;
+        }
+    };
+
+    /**
+     * Decoder of one format, the pipeline of its encoding & compression
+     * feeding the output stage of its layout.
+     */
+    template<eEnc E, eComp C, typename T, bool Split>
+    static size_t decode(const sDecodeSrc& p_src, const sDecodeDst& p_dst) {
+        return sPipe<E, C>::template run<sStore<T, Split>>(p_src, p_dst);
+    }
+
+    // Decoders of an encoding & compression. ([32-bit][split])
+    template<eEnc E, eComp C> struct sDecoders {
+        static const gidDecoder fns[2][2];
+    };
+
+    template<eEnc E, eComp C>
+    const gidDecoder sDecoders<E, C>::fns[2][2] = {
+        { &decode<E, C, uint16_t, false>, &decode<E, C, uint16_t, true> },
+        { &decode<E, C, uint32_t, false>, &decode<E, C, uint32_t, true> }
+    };
+
+    gidDecoder findDecoder(
+        eEnc p_enc,
+        eComp p_comp,
+        unsigned int p_bits,
+        bool p_split
+    ) {
+        if (p_bits != 16 && p_bits != 32)
+            return nullptr;
+
+        const gidDecoder (*fns)[2] = nullptr;
+        if (p_enc == eEnc::csv && p_comp == eComp::none)
+            fns = sDecoders<eEnc::csv, eComp::none>::fns;
+        else if (p_enc == eEnc::xml && p_comp == eComp::none)
+            fns = sDecoders<eEnc::xml, eComp::none>::fns;
+        else if (p_enc == eEnc::base64 && p_comp == eComp::none)
+            fns = sDecoders<eEnc::base64, eComp::none>::fns;
+        else if (p_enc == eEnc::base64 && p_comp == eComp::zlib)
+            fns = sDecoders<eEnc::base64, eComp::zlib>::fns;
+        else if (p_enc == eEnc::base64 && p_comp == eComp::gzip)
+            fns = sDecoders<eEnc::base64, eComp::gzip>::fns;
+
+        return fns ? fns[p_bits == 32][p_split] : nullptr;
+    }
+
+    bool encodingOf(str_p p_enc, eEnc& p_out) {
+        if (p_enc == TMX_UNDEFINED_ATTRIBUTE || p_enc == "xml")
+            p_out = eEnc::xml;
+        else if (p_enc == "csv")
+            p_out = eEnc::csv;
+        else if (p_enc == "base64")
+            p_out = eEnc::base64;
+        else
+            return false;
+        return true;
+    }
+
+    bool compressionOf(str_p p_comp, eComp& p_out) {
+        if (p_comp == TMX_UNDEFINED_ATTRIBUTE || p_comp == "none" ||
+            p_comp.empty())
+            p_out = eComp::none;
+        else if (p_comp == "zlib")
+            p_out = eComp::zlib;
+        else if (p_comp == "gzip")
+            p_out = eComp::gzip;
+        else
+            return false;
+        return true;
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef LM_TMX_DECODE_H
+#define LM_TMX_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Tile layer data decoders. Every combination of encoding, compression and
+ * output layout is its own specialization of one pipeline template, so the
+ * only branch on the layer's format is picking its decoder. Uncompressed
+ * data is decoded & stored in a single loop; compressed data is decoded
+ * from base64 whole, inflated, then stored.
+ *
+ * Output layouts:
+ *  32-bit: gids with their flip flags, as stored in the map.
+ *  16-bit: gids packed with their flip flags, 13 bits of gid & 3 of flags,
+ *          as in tilelayer's eStore::dense16. Picked by the loader when the
+ *          map's tilesets all fit, so the layer is decoded straight into
+ *          its packed form.
+ *  Split:  either width without the flip flags, which go to a separate
+ *          byte array instead. (gid >> 29) 16-bit gids keep their low 16
+ *          bits.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_DECODE_CHUNK 4096 //@- Characters of text decoded per block.
+
+namespace tmx {
+    // Layer data to decode.
+    struct sDecodeSrc {
+        const char* raw; //@- Text of the <data> node. (csv & base64)
+        size_t len; //@- Length of the text.
+        rapidxml::xml_node<>* node; //@- The <data> node. (xml)
+    };
+
+    // Where decoded gids go.
+    struct sDecodeDst {
+        void* gids; //@- uint32_t or uint16_t array, per the decoder.
+        uint8_t* flags; //@- Flip flags, split decoders only.
+        //@- ORed with the gid bits that didn't fit, 16-bit decoders only.
+        uint32_t* lost;
+        size_t count; //@- Size of the arrays in tiles.
+    };
+
+    /**
+     * Decodes a layer's gids. Tiles past the end of the data are left as
+     * they are, so anything short of p_dst.count means the data is...
+     * ...truncated or corrupt.
+     *
+     * @param p_src The data to decode.
+     * @param p_dst Where to write the gids.
+     * @returns [size_t] Number of gids decoded, 0 if compressed data...
+     * ...fails to inflate or its checksum doesn't match.
+     */
+    typedef size_t (*gidDecoder)(const sDecodeSrc& p_src,
+                                 const sDecodeDst& p_dst);
+
+    /**
+     * Picks the decoder of a layer data format.
+     *
+     * @param p_enc Encoding of the data: csv, xml or base64.
+     * @param p_comp Compression of the data, base64 only.
+     * @param p_bits Width of the gids to write, 16 or 32. Defaults to 32.
+     * @param p_split Whether or not to write the flip flags separately.
+     * @returns [gidDecoder] The decoder, nullptr if the format isn't...
+     * ...supported.
+     */
+    gidDecoder findDecoder(
+        eEnc p_enc,
+        eComp p_comp,
+        unsigned int p_bits = 32,
+        bool p_split = false
+    );
+
+    /**
+     * Reads a <data> node's encoding attribute.
+     *
+     * @param p_enc Value of the attribute, TMX_UNDEFINED_ATTRIBUTE = xml.
+     * @param p_out Set to the encoding.
+     * @returns [bool] Whether or not the encoding is known.
+     */
+    bool encodingOf(str_p p_enc, eEnc& p_out);
+
+    /**
+     * Reads a <data> node's compression attribute.
+     *
+     * @param p_comp Value of the attribute, TMX_UNDEFINED_ATTRIBUTE = none.
+     * @param p_out Set to the compression.
+     * @returns [bool] Whether or not the compression is known.
+     */
+    bool compressionOf(str_p p_comp, eComp& p_out);
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "tmx_delta.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define TMX_SIMD_DIFF
+#endif
+
+#define TMX_DELTA_MIN_FILL 3 //@- Shortest run of one gid sent as a fill.
+
+/**
+ * Append an unsigned LEB128 varint.
+ *
+ * @param p_out Buffer to append to.
+ * @param p_v Value to append.
+ */
+static inline void putVarint(std::vector<uint8_t>& p_out, uint64_t p_v) {
+    while (p_v >= 0x80) {
+        p_out.push_back((uint8_t)(p_v | 0x80));
+        p_v >>= 7;
+    }
+    p_out.push_back((uint8_t)p_v);
+}
+
+/**
+ * Read an unsigned LEB128 varint.
+ *
+ * @param p_at Position to read from, advanced past the varint.
+ * @param p_end End of the buffer.
+ * @param p_v Value read.
+ * @returns [bool] false = truncated or overlong varint.
+ */
+static inline bool getVarint(const uint8_t*& p_at, const uint8_t* p_end,
+                             uint64_t& p_v) {
+    p_v = 0;
+    for (unsigned int shift = 0; shift < 64 && p_at < p_end; shift += 7) {
+        const uint8_t b = *p_at++;
+        p_v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/** @returns [uint32_t] Gid with its 3 flip flags rotated to the low bits. */
+static inline uint32_t packGid(uint32_t p_gid) {
+    return (p_gid << 3) | (p_gid >> 29);
+}
+
+/** @returns [uint32_t] Gid as packed by packGid. */
+static inline uint32_t unpackGid(uint32_t p_v) {
+    return (p_v >> 3) | (p_v << 29);
+}
+
+/**
+ * Find the first cell from p_i on where the arrays differ (p_diff = true)
+ * or match (p_diff = false).
+ *
+ * @returns [size_t] Index of the cell, p_n if there is none.
+ */
+static size_t scan(const uint32_t* p_a, const uint32_t* p_b,
+                   size_t p_i, size_t p_n, bool p_diff) {
+#ifdef TMX_SIMD_DIFF
+    // Lanes that stop the scan have their bit set in the mask.
+    const int stop = p_diff ? 0xFFFF : 0;
+    for (; p_i + 4 <= p_n; p_i += 4) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(p_a + p_i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(p_b + p_i));
+        const int m = _mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) ^ stop;
+        if (m != 0)
+            return p_i + (__builtin_ctz(m) >> 2);
+    }
+#endif
+    for (; p_i < p_n; p_i++)
+        if ((p_a[p_i] != p_b[p_i]) == p_diff)
+            return p_i;
+    return p_n;
+}
+
+namespace tmx {
+    size_t diffGids(
+        const uint32_t* p_old,
+        const uint32_t* p_new,
+        unsigned int p_w,
+        unsigned int p_h,
+        std::vector<uint8_t>& p_out
+    ) {
+        p_out.clear();
+        p_out.push_back('T');
+        p_out.push_back('M');
+        p_out.push_back('X');
+        p_out.push_back('D');
+        putVarint(p_out, p_w);
+        putVarint(p_out, p_h);
+
+        const size_t n = (size_t)p_w * p_h;
+        size_t i = 0;
+        while (true) {
+            const size_t from = scan(p_old, p_new, i, n, true);
+            if (from == n)
+                break;
+            if (from > i)
+                putVarint(p_out, (uint64_t)(from - i) << 2 | TMX_DELTA_SKIP);
+
+            // Split the changed run into fills of repeated gids and copies
+            // of everything in between.
+            const size_t to = scan(p_old, p_new, from, n, false);
+            size_t copy = from;
+            for (size_t j = from; j < to;) {
+                size_t k = j + 1;
+                while (k < to && p_new[k] == p_new[j])
+                    k++;
+                if (k - j < TMX_DELTA_MIN_FILL) {
+                    j = k;
+                    continue;
+                }
+
+                if (j > copy) {
+                    putVarint(p_out, (uint64_t)(j - copy) << 2 |
+                                     TMX_DELTA_COPY);
+                    for (; copy < j; copy++)
+                        putVarint(p_out, packGid(p_new[copy]));
+                }
+                putVarint(p_out, (uint64_t)(k - j) << 2 | TMX_DELTA_FILL);
+                putVarint(p_out, packGid(p_new[j]));
+                copy = j = k;
+            }
+            if (to > copy) {
+                putVarint(p_out, (uint64_t)(to - copy) << 2 | TMX_DELTA_COPY);
+                for (; copy < to; copy++)
+                    putVarint(p_out, packGid(p_new[copy]));
+            }
+            i = to;
+        }
+        return p_out.size();
+    }
+
+    bool diffLayers(
+        const tilelayer& p_old,
+        const tilelayer& p_new,
+        std::vector<uint8_t>& p_out
+    ) {
+        const unsigned int w = p_new.width();
+        const unsigned int h = p_new.height();
+        if (p_old.width() != w || p_old.height() != h)
+            return false;
+
+        std::vector<uint32_t> a((size_t)w * h);
+        std::vector<uint32_t> b((size_t)w * h);
+        p_old.read(0, 0, w, h, a.data());
+        p_new.read(0, 0, w, h, b.data());
+        diffGids(a.data(), b.data(), w, h, p_out);
+        return true;
+    }
+
+    /**
+     * Decodes a delta, handing each changed cell to a setter.
+     *
+     * @param p_set Called with (cell index, gid) for each changed cell.
+     * @returns [bool] false = the delta is corrupt or of another size.
+     */
+    template <class F>
+    static bool walkDelta(
+        const uint8_t* p_delta,
+        size_t p_len,
+        unsigned int p_w,
+        unsigned int p_h,
+        F p_set
+    ) {
+        const uint8_t* at = p_delta;
+        const uint8_t* end = p_delta + p_len;
+        if (p_len < 4 || at[0] != 'T' || at[1] != 'M' ||
+            at[2] != 'X' || at[3] != 'D')
+            return false;
+        at += 4;
+
+        uint64_t w, h;
+        if (!getVarint(at, end, w) || !getVarint(at, end, h) ||
+            w != p_w || h != p_h)
+            return false;
+
+        const uint64_t n = w * h;
+        uint64_t i = 0;
+        while (at < end) {
+            uint64_t op, v;
+            if (!getVarint(at, end, op))
+                return false;
+            const uint64_t count = op >> 2;
+            if (count > n - i)
+                return false;
+
+            switch (op & 3) {
+            case TMX_DELTA_SKIP:
+                break;
+            case TMX_DELTA_COPY:
+                for (uint64_t j = 0; j < count; j++) {
+                    if (!getVarint(at, end, v) || v > UINT32_MAX)
+                        return false;
+                    p_set(i + j, unpackGid((uint32_t)v));
+                }
+                break;
+            case TMX_DELTA_FILL:
+                if (!getVarint(at, end, v) || v > UINT32_MAX)
+                    return false;
+                for (uint64_t j = 0; j < count; j++)
+                    p_set(i + j, unpackGid((uint32_t)v));
+                break;
+            default:
+                return false;
+            }
+            i += count;
+        }
+        return true;
+    }
+
+    bool applyDelta(
+        const uint8_t* p_delta,
+        size_t p_len,
+        uint32_t* p_gids,
+        unsigned int p_w,
+        unsigned int p_h
+    ) {
+        return walkDelta(p_delta, p_len, p_w, p_h,
+            [p_gids](uint64_t p_i, uint32_t p_gid) { p_gids[p_i] = p_gid; });
+    }
+
+    bool applyDelta(const uint8_t* p_delta, size_t p_len, tilelayer& p_tiles) {
+        const unsigned int w = p_tiles.width();
+        return walkDelta(p_delta, p_len, w, p_tiles.height(),
+            [&p_tiles, w](uint64_t p_i, uint32_t p_gid) {
+                p_tiles.set(p_i % w, p_i / w, p_gid);
+            });
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef LM_TMX_DELTA_H
+#define LM_TMX_DELTA_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Compact binary deltas between two versions of a tile layer, to replicate
+ * tile edits without sending whole layers.
+ *
+ * Format: "TMXD", varint width, varint height, then ops until the end of
+ * the buffer. Each op starts with a varint (count << 2 | op):
+ *  - TMX_DELTA_SKIP: count cells are unchanged.
+ *  - TMX_DELTA_COPY: count cells follow, one varint gid each.
+ *  - TMX_DELTA_FILL: count cells are set to the one varint gid following.
+ * Cells run row-major, trailing unchanged cells are omitted. Gids are stored
+ * with their flip flags rotated into the low bits so flipped tiles stay short.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_DELTA_SKIP 0
+#define TMX_DELTA_COPY 1
+#define TMX_DELTA_FILL 2
+
+namespace tmx {
+    /**
+     * Builds the delta turning one gid array into another. Unchanged cells
+     * are skipped 4 at a time where the target supports it. (SSE2)
+     *
+     * @param p_old Gids of the previous version, row-major.
+     * @param p_new Gids of the new version, row-major.
+     * @param p_w Width of the layer in tiles.
+     * @param p_h Height of the layer in tiles.
+     * @param p_out Buffer to write the delta to, cleared first.
+     * @returns [size_t] Size of the delta in bytes.
+     */
+    size_t diffGids(
+        const uint32_t* p_old,
+        const uint32_t* p_new,
+        unsigned int p_w,
+        unsigned int p_h,
+        std::vector<uint8_t>& p_out
+    );
+
+    /**
+     * Builds the delta turning one tile layer into another.
+     *
+     * @param p_old Previous version of the layer.
+     * @param p_new New version of the layer.
+     * @param p_out Buffer to write the delta to, cleared first.
+     * @returns [bool] false = the layers differ in size.
+     */
+    bool diffLayers(
+        const tilelayer& p_old,
+        const tilelayer& p_new,
+        std::vector<uint8_t>& p_out
+    );
+
+    /**
+     * Applies a delta to a gid array in place.
+     *
+     * !WARNING! A corrupt delta is detected as it is applied, the cells...
+     * ...before the error are left changed.
+     *
+     * @param p_delta The delta.
+     * @param p_len Size of the delta in bytes.
+     * @param p_gids Gids to update, row-major.
+     * @param p_w Width of the layer in tiles.
+     * @param p_h Height of the layer in tiles.
+     * @returns [bool] false = the delta is corrupt or of another size.
+     */
+    bool applyDelta(
+        const uint8_t* p_delta,
+        size_t p_len,
+        uint32_t* p_gids,
+        unsigned int p_w,
+        unsigned int p_h
+    );
+
+    /**
+     * Applies a delta to a tile layer in place. Only the chunks of changed
+     * tiles get their revision bumped.
+     *
+     * @param p_delta The delta.
+     * @param p_len Size of the delta in bytes.
+     * @param p_tiles Layer to update.
+     * @returns [bool] false = the delta is corrupt or of another size.
+     */
+    bool applyDelta(const uint8_t* p_delta, size_t p_len, tilelayer& p_tiles);
+}
+
+#endif
@@ -0,0 +1,275 @@
+#include <cmath>
+#include <algorithm>
+
+#include "tmx_geometry.h"
+#include "tmx_utils.h"
+
+/**
+ * Cross product of the edges (p_a, p_b) and (p_b, p_c).
+ *
+ * @param p_pts Vertices. (x0, y0, x1, y1...)
+ * @returns [float] > 0 if the edges turn clockwise on screen. (y down)
+ */
+static inline float turn(const float* p_pts,
+                         uint32_t p_a, uint32_t p_b, uint32_t p_c) {
+    const float* a = p_pts + 2 * p_a;
+    const float* b = p_pts + 2 * p_b;
+    const float* c = p_pts + 2 * p_c;
+    return (b[0] - a[0]) * (c[1] - b[1]) - (b[1] - a[1]) * (c[0] - b[0]);
+}
+
+namespace tmx {
+    // Geometry of one object before it is merged into its group's buffers.
+    struct sLocalGeom {
+        sObjGeom geom;
+        std::vector<float> points;
+        std::vector<uint32_t> indices;
+    };
+
+    size_t triangulate(
+        const float* p_points,
+        uint32_t p_count,
+        uint32_t p_base,
+        std::vector<uint32_t>& p_out
+    ) {
+        if (p_count < 3)
+            return 0;
+
+        // Winding of the polygon, ears turn the same way.
+        float area = 0;
+        for (uint32_t i = 0, j = p_count - 1; i < p_count; j = i++)
+            area += p_points[2 * j] * p_points[2 * i + 1] -
+                    p_points[2 * i] * p_points[2 * j + 1];
+        const float wind = (area >= 0) ? 1 : -1;
+
+        std::vector<uint32_t> v(p_count);
+        for (uint32_t i = 0; i < p_count; i++)
+            v[i] = i;
+
+        size_t tris = 0;
+        size_t i = 0, misses = 0;
+        while (v.size() > 3 && misses < v.size()) {
+            const size_t m = v.size();
+            const uint32_t a = v[(i + m - 1) % m], b = v[i % m],
+                           c = v[(i + 1) % m];
+            const float t = turn(p_points, a, b, c) * wind;
+
+            // Flat corner, drop the vertex without a triangle.
+            if (t == 0) {
+                v.erase(v.begin() + (i % m));
+                misses = 0;
+                continue;
+            }
+
+            bool ear = (t > 0);
+            for (size_t k = 0; ear && k < m; k++) {
+                const uint32_t p = v[k];
+                if (p == a || p == b || p == c)
+                    continue;
+                if (turn(p_points, a, b, p) * wind >= 0 &&
+                    turn(p_points, b, c, p) * wind >= 0 &&
+                    turn(p_points, c, a, p) * wind >= 0)
+                    ear = false;
+            }
+
+            if (!ear) {
+                i = (i + 1) % m;
+                misses++;
+                continue;
+            }
+
+            p_out.push_back(p_base + a);
+            p_out.push_back(p_base + b);
+            p_out.push_back(p_base + c);
+            tris++;
+            v.erase(v.begin() + (i % m));
+            misses = 0;
+        }
+
+        if (v.size() == 3 && turn(p_points, v[0], v[1], v[2]) != 0) {
+            p_out.push_back(p_base + v[0]);
+            p_out.push_back(p_base + v[1]);
+            p_out.push_back(p_base + v[2]);
+            tris++;
+        }
+        return tris;
+    }
+
+    /**
+     * Builds the geometry of an object in world space.
+     *
+     * @param p_object The <object> node.
+     * @param p_offx Horizontal offset of the object group.
+     * @param p_offy Vertical offset of the object group.
+     * @param p_out Geometry to write to.
+     */
+    static void buildObject(const sNode& p_object, float p_offx, float p_offy,
+                            sLocalGeom& p_out) {
+        const float x = valDec(getNodeVar(p_object, "x"));
+        const float y = valDec(getNodeVar(p_object, "y"));
+        const float w = valDec(getNodeVar(p_object, "width"));
+        const float h = valDec(getNodeVar(p_object, "height"));
+        const float rad = valDec(getNodeVar(p_object, "rotation")) *
+                          3.14159265358979f / 180;
+        const float cs = std::cos(rad), sn = std::sin(rad);
+
+        p_out.geom.shape = eTag::object;
+        for (auto it = p_object.nodes; it; it = it->next()) {
+            const eTag t = it->valptr()->tag;
+            if (t == eTag::ellipse || t == eTag::polygon ||
+                t == eTag::polyline) {
+                p_out.geom.shape = t;
+                if (t != eTag::ellipse) {
+                    const std::string pts =
+                        getNodeVar(*it->valptr(), "points").value;
+                    p_out.points.resize(pts.size() + 2);
+                    const size_t n = parsePoints(pts.c_str(), pts.size(),
+                                                 p_out.points.data(),
+                                                 p_out.points.size());
+                    p_out.points.resize(n & ~(size_t)1);
+                }
+                break;
+            }
+        }
+
+        // Local outline, relative to the object's (x, y).
+        std::vector<float>& p = p_out.points;
+        switch (p_out.geom.shape) {
+        case eTag::ellipse:
+            p.resize(2 * TMX_GEOM_ELLIPSE_SEGMENTS);
+            for (unsigned int i = 0; i < TMX_GEOM_ELLIPSE_SEGMENTS; i++) {
+                const float a = 2 * 3.14159265358979f * i /
+                                TMX_GEOM_ELLIPSE_SEGMENTS;
+                p[2 * i] = w / 2 + std::cos(a) * w / 2;
+                p[2 * i + 1] = h / 2 + std::sin(a) * h / 2;
+            }
+            break;
+        case eTag::polygon:
+        case eTag::polyline:
+            break;
+        default: {
+            // Tile objects hang above their (x, y).
+            const float top =
+                (getNodeVar(p_object, "gid").type != eType::error) ? -h : 0;
+            p = { 0, top, w, top, w, top + h, 0, top + h };
+            break;
+        }
+        }
+
+        const uint32_t n = p.size() / 2;
+        switch (p_out.geom.shape) {
+        case eTag::polygon:
+            triangulate(p.data(), n, 0, p_out.indices);
+            break;
+        case eTag::polyline:
+            break;
+        default:
+            // Convex outlines, triangulated as a fan.
+            for (uint32_t i = 1; i + 1 < n; i++) {
+                p_out.indices.push_back(0);
+                p_out.indices.push_back(i);
+                p_out.indices.push_back(i + 1);
+            }
+            break;
+        }
+
+        // Rotate around (x, y) and move to world space.
+        float minx = INFINITY, miny = INFINITY;
+        float maxx = -INFINITY, maxy = -INFINITY;
+        for (uint32_t i = 0; i < n; i++) {
+            const float lx = p[2 * i], ly = p[2 * i + 1];
+            p[2 * i] = p_offx + x + lx * cs - ly * sn;
+            p[2 * i + 1] = p_offy + y + lx * sn + ly * cs;
+            minx = std::min(minx, p[2 * i]);
+            miny = std::min(miny, p[2 * i + 1]);
+            maxx = std::max(maxx, p[2 * i]);
+            maxy = std::max(maxy, p[2 * i + 1]);
+        }
+
+        // The outline cuts inside a rotated ellipse, use its exact bounds.
+        if (p_out.geom.shape == eTag::ellipse) {
+            const float cx = p_offx + x + (w / 2) * cs - (h / 2) * sn;
+            const float cy = p_offy + y + (w / 2) * sn + (h / 2) * cs;
+            const float ex = std::sqrt(w * w * cs * cs + h * h * sn * sn) / 2;
+            const float ey = std::sqrt(w * w * sn * sn + h * h * cs * cs) / 2;
+            minx = cx - ex;
+            maxx = cx + ex;
+            miny = cy - ey;
+            maxy = cy + ey;
+        }
+
+        if (n == 0) {
+            minx = maxx = p_offx + x;
+            miny = maxy = p_offy + y;
+        }
+        p_out.geom.minx = minx;
+        p_out.geom.miny = miny;
+        p_out.geom.maxx = maxx;
+        p_out.geom.maxy = maxy;
+    }
+
+    size_t buildGeometry(sNode& p_map, unsigned int p_threads) {
+        size_t total = 0;
+
+        for (auto g = p_map.nodes; g; g = g->next()) {
+            sNode& group = *g->valptr();
+            if (group.tag != eTag::objectgroup)
+                continue;
+
+            std::vector<sNode*> objects;
+            for (auto it = group.nodes; it; it = it->next())
+                if (it->valptr()->tag == eTag::object)
+                    objects.push_back(it->valptr());
+
+            const float offx = valDec(getNodeVar(group, "offsetx"));
+            const float offy = valDec(getNodeVar(group, "offsety"));
+
+            std::vector<sLocalGeom> local(objects.size());
+            parallelFor(objects.size(), [&](size_t i) {
+                buildObject(*objects[i], offx, offy, local[i]);
+            }, p_threads);
+
+            // Merge the objects' geometry into the group's buffers, each
+            // object keeping the index of its entry.
+            sGeometry* geom = new sGeometry();
+            geom->objects.resize(objects.size());
+            for (size_t i = 0; i < objects.size(); i++) {
+                if (objects[i]->data == nullptr)
+                    objects[i]->data = new sData(mkData("", eEnc::text));
+                objects[i]->data->geomindex = (uint32_t)i;
+
+                sObjGeom& o = geom->objects[i];
+                o = local[i].geom;
+                o.vertex = geom->points.size() / 2;
+                o.vertices = local[i].points.size() / 2;
+                o.index = geom->indices.size();
+                o.indices = local[i].indices.size();
+                geom->points.insert(geom->points.end(),
+                                    local[i].points.begin(),
+                                    local[i].points.end());
+                for (size_t k = 0; k < local[i].indices.size(); k++)
+                    geom->indices.push_back(o.vertex + local[i].indices[k]);
+            }
+
+            if (group.data == nullptr)
+                group.data = new sData(mkData("", eEnc::text));
+            delete group.data->geom;
+            group.data->geom = geom;
+            total += objects.size();
+        }
+        return total;
+    }
+
+    const sObjGeom* objectGeometry(const sNode& p_group,
+                                   const sNode& p_object) {
+        if (p_group.data == nullptr || p_group.data->geom == nullptr)
+            return nullptr;
+
+        const std::vector<sObjGeom>& objects = p_group.data->geom->objects;
+        const uint32_t i = (p_object.data != nullptr) ?
+                           p_object.data->geomindex : TMX_GEOM_NONE;
+        if (i >= objects.size())
+            return nullptr;
+        return &objects[i];
+    }
+}
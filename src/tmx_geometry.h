@@ -0,0 +1,86 @@
+#ifndef LM_TMX_GEOMETRY_H
+#define LM_TMX_GEOMETRY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Precomputed geometry of <objectgroup> objects: world space bounding boxes,
+ * outlines and triangle meshes. Each object group keeps the geometry of all
+ * its objects in one set of contiguous buffers, (sData::geom) with one entry
+ * per <object> in document order, and each object the index of its entry.
+ * (sData::geomindex) Adding, removing or moving objects needs a rebuild.
+ *
+ * Rotations are clockwise in degrees around the object's (x, y), like in the
+ * editor. Tile objects are anchored at their bottom-left corner.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_GEOM_ELLIPSE_SEGMENTS 32 //@- Outline vertices of an ellipse.
+#define TMX_GEOM_NONE 0xFFFFFFFFu //@- Object without geometry.
+
+namespace tmx {
+    // Geometry of one object.
+    struct sObjGeom {
+        //@- Shape: object (rectangle or tile), ellipse, polygon or polyline.
+        eTag shape;
+        float minx, miny, maxx, maxy; //@- World space bounding box.
+        uint32_t vertex; //@- First outline vertex in sGeometry::points.
+        uint32_t vertices; //@- Number of outline vertices.
+        uint32_t index; //@- First triangle index in sGeometry::indices.
+        uint32_t indices; //@- Number of triangle indices. (0 for polylines)
+    };
+
+    // Geometry buffers of an object group.
+    struct sGeometry {
+        std::vector<sObjGeom> objects; //@- One per <object>, in order.
+        std::vector<float> points; //@- World space vertices. (x0, y0...)
+        //@- Triangles as vertex indices into points, 3 per triangle.
+        std::vector<uint32_t> indices;
+    };
+
+    /**
+     * Builds the geometry of every object group of a map, replacing any
+     * built before. Objects are processed in parallel.
+     *
+     * @param p_map The root <map> node.
+     * @param p_threads Maximum number of threads, defaults to one per core.
+     * @returns [size_t] Number of objects processed.
+     */
+    size_t buildGeometry(sNode& p_map, unsigned int p_threads = 0);
+
+    /**
+     * Get the geometry of an object, through the entry index the build
+     * stored in its sData. (sData::geomindex)
+     *
+     * @param p_group The <objectgroup> node holding the object.
+     * @param p_object The <object> node.
+     * @returns [const sObjGeom*] The object's geometry, nullptr if none...
+     * ...was built.
+     */
+    const sObjGeom* objectGeometry(const sNode& p_group, const sNode& p_object);
+
+    /**
+     * Triangulates a simple polygon by ear clipping. Collinear and repeated
+     * vertices are dropped, the rest of a self-intersecting polygon is left
+     * untriangulated.
+     *
+     * @param p_points Vertices of the polygon. (x0, y0, x1, y1...)
+     * @param p_count Number of vertices.
+     * @param p_base Added to every index written.
+     * @param p_out Indices to append the triangles to, 3 per triangle.
+     * @returns [size_t] Number of triangles written.
+     */
+    size_t triangulate(
+        const float* p_points,
+        uint32_t p_count,
+        uint32_t p_base,
+        std::vector<uint32_t>& p_out
+    );
+}
+
+#endif
@@ -0,0 +1,499 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <utility>
+
+#include "tmx_intern.h"
+
+#define TMX_INTERN_SEGMENTS 23 //@- Segments needed to cover 2^32 strings.
+
+/**
+ * Hashes a string. (FNV-1a)
+ *
+ * @param p_str The string's characters.
+ * @param p_len Length of the string.
+ * @returns [uint32_t] The string's hash.
+ */
+static inline uint32_t hashStr(const char* p_str, size_t p_len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < p_len; i++)
+        h = (h ^ (uint8_t)p_str[i]) * 16777619u;
+    return h;
+}
+
+/**
+ * Finds where a string is stored. Segment k holds TMX_INTERN_SEGMENT << k
+ * strings, so the pool doubles each time it runs out of room.
+ *
+ * @param p_id Index of the string.
+ * @param p_seg Set to the string's segment.
+ * @param p_at Set to the string's index within its segment.
+ */
+static inline void locate(uint32_t p_id, unsigned int& p_seg,
+                          uint32_t& p_at) {
+    const uint64_t n = (uint64_t)p_id / TMX_INTERN_SEGMENT + 1;
+    p_seg = 63 - __builtin_clzll(n);
+    p_at = p_id - TMX_INTERN_SEGMENT * ((1ull << p_seg) - 1);
+}
+
+namespace tmx {
+    // Open addressing index of the pool, (hash << 32 | id + 1) per slot and
+    // 0 for free slots.
+    struct sIndex {
+        size_t mask; //@- Number of slots - 1.
+        std::atomic<uint64_t>* slots;
+    };
+
+    // The pool. Writers hold the lock, readers go through the segments and
+    // the current index without it. Outgrown indices are kept, so readers
+    // still probing them stay valid.
+    struct sPool {
+        std::atomic<std::string*> segs[TMX_INTERN_SEGMENTS];
+        std::atomic<sIndex*> index;
+        std::vector<sIndex*> indices; //@- Every index built.
+        uint32_t count; //@- Strings in the pool.
+        size_t chars; //@- Characters of all strings.
+        size_t capacity; //@- Strings the allocated segments can hold.
+        size_t slots; //@- Slots of every index built.
+        std::atomic<size_t> saved; //@- Bytes saved by repeated strings.
+        std::mutex lock;
+    };
+
+    /**
+     * Builds an empty index.
+     *
+     * @param p_slots Number of slots, a power of 2.
+     * @returns [sIndex*] The index.
+     */
+    static sIndex* mkIndex(size_t p_slots) {
+        sIndex* index = new sIndex();
+        index->mask = p_slots - 1;
+        index->slots = new std::atomic<uint64_t>[p_slots];
+        for (size_t i = 0; i < p_slots; i++)
+            index->slots[i].store(0, std::memory_order_relaxed);
+        return index;
+    }
+
+    /** @returns [sPool*] A new, empty pool. */
+    static sPool* mkPool() {
+        sPool* p = new sPool();
+        for (unsigned int i = 0; i < TMX_INTERN_SEGMENTS; i++)
+            p->segs[i].store(nullptr);
+        p->indices.push_back(mkIndex(TMX_INTERN_SEGMENT));
+        p->index.store(p->indices.back());
+        p->count = 0;
+        p->chars = 0;
+        p->capacity = 0;
+        p->slots = TMX_INTERN_SEGMENT;
+        p->saved.store(0);
+        return p;
+    }
+
+    /** @returns [sPool&] The process-wide pool, never destroyed. */
+    static sPool& pool() {
+        static sPool* p = mkPool();
+        return *p;
+    }
+
+    /** @returns [const std::string&] The string of a handle. */
+    static inline const std::string& poolStr(uint32_t p_id) {
+        unsigned int seg;
+        uint32_t at;
+        locate(p_id, seg, at);
+        return pool().segs[seg].load(std::memory_order_acquire)[at];
+    }
+
+    /**
+     * Looks a string up in an index of the pool.
+     *
+     * @param p_index The index.
+     * @param p_str The string's characters.
+     * @param p_len Length of the string.
+     * @param p_hash Hash of the string.
+     * @param p_slot Set to the string's slot, or the free slot to put it in.
+     * @returns [bool] Whether or not the string was found.
+     */
+    static bool probe(const sIndex& p_index, const char* p_str,
+                      size_t p_len, uint32_t p_hash, size_t& p_slot) {
+        for (size_t i = p_hash & p_index.mask;; i = (i + 1) & p_index.mask) {
+            const uint64_t s = p_index.slots[i].load(std::memory_order_acquire);
+            p_slot = i;
+            if (s == 0)
+                return false;
+            if ((uint32_t)(s >> 32) != p_hash)
+                continue;
+
+            const std::string& str = poolStr((uint32_t)s - 1);
+            if (str.size() == p_len &&
+                std::memcmp(str.data(), p_str, p_len) == 0)
+                return true;
+        }
+    }
+
+    /**
+     * Interns a string.
+     *
+     * @param p_str The string's characters.
+     * @param p_len Length of the string.
+     * @returns [uint32_t] Index of the string in the pool.
+     */
+    static uint32_t intern(const char* p_str, size_t p_len) {
+        sPool& p = pool();
+        const uint32_t h = hashStr(p_str, p_len);
+        const size_t saved = sizeof(std::string) + p_len - sizeof(istr);
+
+        // Strings already in the pool are found without the lock.
+        const sIndex& published = *p.index.load(std::memory_order_acquire);
+        size_t slot;
+        if (probe(published, p_str, p_len, h, slot)) {
+            p.saved.fetch_add(saved, std::memory_order_relaxed);
+            return (uint32_t)published.slots[slot].load() - 1;
+        }
+
+        // Another thread may have added it since, look again under the lock.
+        std::lock_guard<std::mutex> guard(p.lock);
+        sIndex& index = *p.index.load(std::memory_order_relaxed);
+        if (probe(index, p_str, p_len, h, slot)) {
+            p.saved.fetch_add(saved, std::memory_order_relaxed);
+            return (uint32_t)index.slots[slot].load() - 1;
+        }
+
+        // Store the string before its handle can reach other threads.
+        const uint32_t id = p.count;
+        unsigned int seg;
+        uint32_t at;
+        locate(id, seg, at);
+        std::string* strs = p.segs[seg].load(std::memory_order_relaxed);
+        if (strs == nullptr) {
+            strs = new std::string[(size_t)TMX_INTERN_SEGMENT << seg];
+            p.segs[seg].store(strs, std::memory_order_release);
+            p.capacity += (size_t)TMX_INTERN_SEGMENT << seg;
+        }
+        strs[at].assign(p_str, p_len);
+        p.count++;
+        p.chars += p_len;
+        index.slots[slot].store(((uint64_t)h << 32) | (id + 1),
+                                std::memory_order_release);
+
+        // Keep the index at most half full, readers move to the new one
+        // once it's complete.
+        if ((size_t)p.count * 2 > index.mask + 1) {
+            sIndex* grown = mkIndex((index.mask + 1) * 2);
+            for (size_t i = 0; i <= index.mask; i++) {
+                const uint64_t s = index.slots[i].load();
+                if (s == 0)
+                    continue;
+                size_t k = (s >> 32) & grown->mask;
+                while (grown->slots[k].load() != 0)
+                    k = (k + 1) & grown->mask;
+                grown->slots[k].store(s, std::memory_order_relaxed);
+            }
+            p.indices.push_back(grown);
+            p.slots += grown->mask + 1;
+            p.index.store(grown, std::memory_order_release);
+        }
+        return id;
+    }
+
+    istr::istr() {
+        static const uint32_t empty = intern("", 0);
+        _id = empty;
+    }
+
+    istr::istr(const std::string& p_str) {
+        _id = intern(p_str.data(), p_str.size());
+    }
+
+    istr::istr(const char* p_str) {
+        _id = intern(p_str, std::strlen(p_str));
+    }
+
+    bool istr::find(const std::string& p_str, istr& p_out) {
+        const sIndex& index = *pool().index.load(std::memory_order_acquire);
+        const uint32_t h = hashStr(p_str.data(), p_str.size());
+
+        size_t slot;
+        if (!probe(index, p_str.data(), p_str.size(), h, slot))
+            return false;
+        p_out._id = (uint32_t)index.slots[slot].load() - 1;
+        return true;
+    }
+
+    uint32_t istr::id() const {
+        return _id;
+    }
+
+    const std::string& istr::str() const {
+        return poolStr(_id);
+    }
+
+    const char* istr::c_str() const {
+        return str().c_str();
+    }
+
+    size_t istr::size() const {
+        return str().size();
+    }
+
+    bool istr::empty() const {
+        return str().empty();
+    }
+
+    char istr::operator[](size_t p_i) const {
+        return str()[p_i];
+    }
+
+    istr::operator const std::string&() const {
+        return str();
+    }
+
+    bool istr::operator==(const istr& p_other) const {
+        return _id == p_other._id;
+    }
+
+    bool istr::operator!=(const istr& p_other) const {
+        return _id != p_other._id;
+    }
+
+    bool istr::operator==(const std::string& p_str) const {
+        return str() == p_str;
+    }
+
+    bool istr::operator!=(const std::string& p_str) const {
+        return str() != p_str;
+    }
+
+    bool istr::operator==(const char* p_str) const {
+        return str() == p_str;
+    }
+
+    bool istr::operator!=(const char* p_str) const {
+        return str() != p_str;
+    }
+
+    bool operator==(const std::string& p_str, const istr& p_istr) {
+        return p_istr == p_str;
+    }
+
+    bool operator!=(const std::string& p_str, const istr& p_istr) {
+        return p_istr != p_str;
+    }
+
+    bool operator==(const char* p_str, const istr& p_istr) {
+        return p_istr == p_str;
+    }
+
+    bool operator!=(const char* p_str, const istr& p_istr) {
+        return p_istr != p_str;
+    }
+
+    bool operator<(const istr& p_a, const istr& p_b) {
+        return p_a.str() < p_b.str();
+    }
+
+    std::string operator+(const istr& p_a, const istr& p_b) {
+        return p_a.str() + p_b.str();
+    }
+
+    std::string operator+(const istr& p_istr, const std::string& p_str) {
+        return p_istr.str() + p_str;
+    }
+
+    std::string operator+(const std::string& p_str, const istr& p_istr) {
+        return p_str + p_istr.str();
+    }
+
+    std::string operator+(const istr& p_istr, const char* p_str) {
+        return p_istr.str() + p_str;
+    }
+
+    std::string operator+(const char* p_str, const istr& p_istr) {
+        return p_str + p_istr.str();
+    }
+
+    std::string operator+(const istr& p_istr, char p_c) {
+        return p_istr.str() + p_c;
+    }
+
+    std::string operator+(char p_c, const istr& p_istr) {
+        return p_c + p_istr.str();
+    }
+
+    std::ostream& operator<<(std::ostream& p_os, const istr& p_istr) {
+        return p_os << p_istr.str();
+    }
+
+    std::string operator+(const istr& p_a, const vstr& p_b) {
+        return p_a.str() + p_b.str();
+    }
+
+    std::string operator+(const vstr& p_a, const istr& p_b) {
+        return p_a.str() + p_b.str();
+    }
+
+    sInternStats internStats() {
+        sPool& p = pool();
+        std::lock_guard<std::mutex> guard(p.lock);
+        return {
+            p.count,
+            p.capacity * sizeof(std::string) + p.chars +
+                p.slots * sizeof(uint64_t),
+            p.saved.load(std::memory_order_relaxed)
+        };
+    }
+
+    vstr::vstr() {
+        _v = ((uintptr_t)istr().id() << 1) | 1;
+    }
+
+    vstr::vstr(const std::string& p_str) {
+        _v = p_str.empty() ? ((uintptr_t)istr().id() << 1) | 1 :
+                             (uintptr_t)new std::string(p_str);
+    }
+
+    vstr::vstr(const char* p_str) : vstr(std::string(p_str)) {}
+
+    vstr::vstr(const istr& p_istr) {
+        _v = ((uintptr_t)p_istr.id() << 1) | 1;
+    }
+
+    vstr::vstr(const vstr& p_other) {
+        _v = p_other.interned() ? p_other._v :
+                                  (uintptr_t)new std::string(p_other.str());
+    }
+
+    vstr::vstr(vstr&& p_other) noexcept {
+        _v = p_other._v;
+        p_other._v = ((uintptr_t)istr().id() << 1) | 1;
+    }
+
+    vstr& vstr::operator=(const vstr& p_other) {
+        if (this != &p_other) {
+            vstr copy(p_other);
+            std::swap(_v, copy._v);
+        }
+        return *this;
+    }
+
+    vstr& vstr::operator=(vstr&& p_other) noexcept {
+        std::swap(_v, p_other._v);
+        return *this;
+    }
+
+    vstr::~vstr() {
+        if (!interned())
+            delete (std::string*)_v;
+    }
+
+    bool vstr::interned() const {
+        return _v & 1;
+    }
+
+    size_t vstr::memory() const {
+        return interned() ? 0 : sizeof(std::string) + str().capacity();
+    }
+
+    const std::string& vstr::str() const {
+        return interned() ? poolStr((uint32_t)(_v >> 1)) :
+                            *(const std::string*)_v;
+    }
+
+    const char* vstr::c_str() const {
+        return str().c_str();
+    }
+
+    size_t vstr::size() const {
+        return str().size();
+    }
+
+    bool vstr::empty() const {
+        return str().empty();
+    }
+
+    char vstr::operator[](size_t p_i) const {
+        return str()[p_i];
+    }
+
+    vstr::operator const std::string&() const {
+        return str();
+    }
+
+    bool vstr::operator==(const vstr& p_other) const {
+        if (interned() && p_other.interned())
+            return _v == p_other._v;
+        return str() == p_other.str();
+    }
+
+    bool vstr::operator!=(const vstr& p_other) const {
+        return !(*this == p_other);
+    }
+
+    bool vstr::operator==(const std::string& p_str) const {
+        return str() == p_str;
+    }
+
+    bool vstr::operator!=(const std::string& p_str) const {
+        return str() != p_str;
+    }
+
+    bool vstr::operator==(const char* p_str) const {
+        return str() == p_str;
+    }
+
+    bool vstr::operator!=(const char* p_str) const {
+        return str() != p_str;
+    }
+
+    bool operator==(const std::string& p_str, const vstr& p_vstr) {
+        return p_vstr == p_str;
+    }
+
+    bool operator!=(const std::string& p_str, const vstr& p_vstr) {
+        return p_vstr != p_str;
+    }
+
+    bool operator==(const char* p_str, const vstr& p_vstr) {
+        return p_vstr == p_str;
+    }
+
+    bool operator!=(const char* p_str, const vstr& p_vstr) {
+        return p_vstr != p_str;
+    }
+
+    bool operator<(const vstr& p_a, const vstr& p_b) {
+        return p_a.str() < p_b.str();
+    }
+
+    std::string operator+(const vstr& p_a, const vstr& p_b) {
+        return p_a.str() + p_b.str();
+    }
+
+    std::string operator+(const vstr& p_vstr, const std::string& p_str) {
+        return p_vstr.str() + p_str;
+    }
+
+    std::string operator+(const std::string& p_str, const vstr& p_vstr) {
+        return p_str + p_vstr.str();
+    }
+
+    std::string operator+(const vstr& p_vstr, const char* p_str) {
+        return p_vstr.str() + p_str;
+    }
+
+    std::string operator+(const char* p_str, const vstr& p_vstr) {
+        return p_str + p_vstr.str();
+    }
+
+    std::string operator+(const vstr& p_vstr, char p_c) {
+        return p_vstr.str() + p_c;
+    }
+
+    std::string operator+(char p_c, const vstr& p_vstr) {
+        return p_c + p_vstr.str();
+    }
+
+    std::ostream& operator<<(std::ostream& p_os, const vstr& p_vstr) {
+        return p_os << p_vstr.str();
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef LM_TMX_INTERN_H
+#define LM_TMX_INTERN_H
+
+#include <stdint.h>
+#include <string>
+#include <iostream>
+
+/**============================================================================
+ * Process-wide string intern pool. Every distinct string is stored once and
+ * referred to through a 32-bit handle (istr) shared by all loaded maps, so
+ * attribute names, property names and repeated values cost 4 bytes each.
+ *
+ * Handles resolve to their string, and find() looks strings up, without
+ * locking: strings are kept in segments that never move and are never
+ * released. Interning a string already in the pool doesn't lock either,
+ * only adding a new one takes the pool's lock.
+ *
+ * Since pooled strings live as long as the process, only strings from a
+ * small set should be interned. Values are held by a vstr, which either
+ * refers to the pool or owns its string.
+ *
+ * Both convert to const std::string& and compare, concatenate and print as
+ * a std::string would, other std::string members are reached via str().
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_INTERN_SEGMENT 1024 //@- Strings in the first pool segment.
+
+namespace tmx {
+    // Pool usage report.
+    struct sInternStats {
+        size_t strings; //@- Distinct strings in the pool.
+        size_t bytes; //@- Bytes held by the pool, strings & index included.
+        //@- Bytes that separate std::string copies would have taken on top.
+        size_t saved;
+    };
+
+    // Handle of an interned string.
+    class istr {
+    public:
+        /** Handle of the empty string. */
+        istr();
+
+        /**
+         * Interns a string.
+         *
+         * @param p_str The string to intern.
+         */
+        istr(const std::string& p_str);
+        istr(const char* p_str);
+
+        /**
+         * Finds the handle of a string without interning it. Strings being
+         * interned by other threads meanwhile may not be found.
+         *
+         * @param p_str The string to look for.
+         * @param p_out Set to the string's handle if found.
+         * @returns [bool] Whether or not the string is in the pool.
+         */
+        static bool find(const std::string& p_str, istr& p_out);
+
+        /** @returns [uint32_t] Index of the string in the pool. */
+        uint32_t id() const;
+        /** @returns [const std::string&] The string. */
+        const std::string& str() const;
+        /** @returns [const char*] The string as a C-string. */
+        const char* c_str() const;
+        /** @returns [size_t] Length of the string. */
+        size_t size() const;
+        /** @returns [bool] Whether or not the string is empty. */
+        bool empty() const;
+
+        char operator[](size_t p_i) const;
+        operator const std::string&() const;
+
+        // Handles compare in constant time, strings compare as usual.
+        bool operator==(const istr& p_other) const;
+        bool operator!=(const istr& p_other) const;
+        bool operator==(const std::string& p_str) const;
+        bool operator!=(const std::string& p_str) const;
+        bool operator==(const char* p_str) const;
+        bool operator!=(const char* p_str) const;
+    private:
+        uint32_t _id;
+    };
+
+    bool operator==(const std::string& p_str, const istr& p_istr);
+    bool operator!=(const std::string& p_str, const istr& p_istr);
+    bool operator==(const char* p_str, const istr& p_istr);
+    bool operator!=(const char* p_str, const istr& p_istr);
+    bool operator<(const istr& p_a, const istr& p_b);
+    std::ostream& operator<<(std::ostream& p_os, const istr& p_istr);
+
+    // Concatenation, as with std::string.
+    std::string operator+(const istr& p_a, const istr& p_b);
+    std::string operator+(const istr& p_istr, const std::string& p_str);
+    std::string operator+(const std::string& p_str, const istr& p_istr);
+    std::string operator+(const istr& p_istr, const char* p_str);
+    std::string operator+(const char* p_str, const istr& p_istr);
+    std::string operator+(const istr& p_istr, char p_c);
+    std::string operator+(char p_c, const istr& p_istr);
+
+    // String that is either interned or owned, in the size of a pointer.
+    class vstr {
+    public:
+        /** The empty string, interned. */
+        vstr();
+
+        /**
+         * Owns a copy of a string. The empty string is interned instead.
+         *
+         * @param p_str The string to copy.
+         */
+        vstr(const std::string& p_str);
+        vstr(const char* p_str);
+
+        /**
+         * Refers to an interned string.
+         *
+         * @param p_istr Handle of the string.
+         */
+        vstr(const istr& p_istr);
+
+        vstr(const vstr& p_other);
+        vstr(vstr&& p_other) noexcept;
+        vstr& operator=(const vstr& p_other);
+        vstr& operator=(vstr&& p_other) noexcept;
+        ~vstr();
+
+        /** @returns [bool] Whether or not the string is interned. */
+        bool interned() const;
+        /** @returns [size_t] Heap bytes owned, 0 if interned. */
+        size_t memory() const;
+
+        /** @returns [const std::string&] The string. */
+        const std::string& str() const;
+        /** @returns [const char*] The string as a C-string. */
+        const char* c_str() const;
+        /** @returns [size_t] Length of the string. */
+        size_t size() const;
+        /** @returns [bool] Whether or not the string is empty. */
+        bool empty() const;
+
+        char operator[](size_t p_i) const;
+        operator const std::string&() const;
+
+        bool operator==(const vstr& p_other) const;
+        bool operator!=(const vstr& p_other) const;
+        bool operator==(const std::string& p_str) const;
+        bool operator!=(const std::string& p_str) const;
+        bool operator==(const char* p_str) const;
+        bool operator!=(const char* p_str) const;
+    private:
+        //@- Interned handle as (id << 1 | 1), or the owned std::string*.
+        uintptr_t _v;
+    };
+
+    bool operator==(const std::string& p_str, const vstr& p_vstr);
+    bool operator!=(const std::string& p_str, const vstr& p_vstr);
+    bool operator==(const char* p_str, const vstr& p_vstr);
+    bool operator!=(const char* p_str, const vstr& p_vstr);
+    bool operator<(const vstr& p_a, const vstr& p_b);
+    std::ostream& operator<<(std::ostream& p_os, const vstr& p_vstr);
+
+    // Concatenation, as with std::string.
+    std::string operator+(const vstr& p_a, const vstr& p_b);
+    std::string operator+(const vstr& p_vstr, const std::string& p_str);
+    std::string operator+(const std::string& p_str, const vstr& p_vstr);
+    std::string operator+(const vstr& p_vstr, const char* p_str);
+    std::string operator+(const char* p_str, const vstr& p_vstr);
+    std::string operator+(const vstr& p_vstr, char p_c);
+    std::string operator+(char p_c, const vstr& p_vstr);
+
+    // Names & values mix in concatenations.
+    std::string operator+(const istr& p_a, const vstr& p_b);
+    std::string operator+(const vstr& p_a, const istr& p_b);
+
+    /** @returns [sInternStats] Current usage of the pool. */
+    sInternStats internStats();
+}
+
+#endif
@@ -0,0 +1,426 @@
+#include <algorithm>
+
+#include "tmx_layer.h"
+
+/**
+ * Pack a gid and its flip flags into 16 bits. (13 bit gid, 3 flag bits)
+ *
+ * @param p_gid Gid to pack, must be within TMX_DENSE16_MAX.
+ * @returns [uint16_t] Packed gid.
+ */
+static inline uint16_t pack16(uint32_t p_gid) {
+    return (uint16_t)((p_gid & TMX_DENSE16_MAX) | ((p_gid >> 16) & 0xE000u));
+}
+
+/**
+ * Unpack a 16-bit packed gid.
+ *
+ * @param p_packed Packed gid.
+ * @returns [uint32_t] Gid with its flip flags.
+ */
+static inline uint32_t unpack16(uint16_t p_packed) {
+    return (p_packed & TMX_DENSE16_MAX) | ((uint32_t)(p_packed & 0xE000u) << 16);
+}
+
+/** @returns [uint32_t] Gid of a dense array entry, unpacked if packed. */
+static inline uint32_t gidOf(uint32_t p_gid) { return p_gid; }
+static inline uint32_t gidOf(uint16_t p_packed) { return unpack16(p_packed); }
+
+/** @returns [uint16_t] Packed gid of a dense array entry. */
+static inline uint16_t packedOf(uint32_t p_gid) { return pack16(p_gid); }
+static inline uint16_t packedOf(uint16_t p_packed) { return p_packed; }
+
+namespace tmx {
+    tilelayer::tilelayer() {
+        _width = 0;
+        _height = 0;
+        _maxgid = 0;
+        _store = eStore::dense32;
+    }
+
+    tilelayer::tilelayer(
+        const uint32_t* p_gids,
+        unsigned int p_width,
+        unsigned int p_height,
+        uint32_t p_maxgid
+    ) {
+        _width = p_width;
+        _height = p_height;
+        _maxgid = p_maxgid;
+
+        // Measure the highest gid actually used.
+        const size_t n = (size_t)_width * _height;
+        for (size_t i = 0; i < n; i++)
+            if ((p_gids[i] & TMX_GID_MASK) > _maxgid)
+                _maxgid = p_gids[i] & TMX_GID_MASK;
+
+        build(p_gids, choose(p_gids));
+        _revs.assign((size_t)chunksX() * chunksY(), 0);
+    }
+
+    tilelayer::tilelayer(
+        std::vector<uint16_t>&& p_packed,
+        unsigned int p_width,
+        unsigned int p_height,
+        uint32_t p_maxgid
+    ) {
+        _width = p_width;
+        _height = p_height;
+        _maxgid = p_maxgid;
+
+        const size_t n = (size_t)_width * _height;
+        p_packed.resize(n);
+        for (size_t i = 0; i < n; i++)
+            if ((p_packed[i] & TMX_DENSE16_MAX) > _maxgid)
+                _maxgid = p_packed[i] & TMX_DENSE16_MAX;
+
+        const eStore store = choose(p_packed.data());
+        if (store == eStore::dense16) {
+            clear();
+            _store = store;
+            _dense16.swap(p_packed);
+        }
+        else
+            build(p_packed.data(), store);
+        _revs.assign((size_t)chunksX() * chunksY(), 0);
+    }
+
+    unsigned int tilelayer::width() const { return _width; }
+    unsigned int tilelayer::height() const { return _height; }
+    eStore tilelayer::store() const { return _store; }
+
+    uint32_t tilelayer::gid(unsigned int p_x, unsigned int p_y) const {
+        if (p_x >= _width || p_y >= _height)
+            return 0;
+
+        const uint32_t i = p_y * _width + p_x;
+        switch (_store) {
+        case eStore::dense32: return _dense32[i];
+        case eStore::dense16: return unpack16(_dense16[i]);
+        case eStore::rle: {
+            // Binary search the row's runs for the last run starting <= x.
+            uint32_t lo = _rows[p_y], hi = _rows[p_y + 1];
+            while (hi - lo > 1) {
+                uint32_t mid = (lo + hi) / 2;
+                if (_runs[mid].x <= p_x) lo = mid;
+                else hi = mid;
+            }
+            return _runs[lo].gid;
+        }
+        case eStore::sparse: {
+            if (!((_bits[i >> 6] >> (i & 63)) & 1))
+                return 0;
+            return _sparse.find(i)->second;
+        }
+        }
+        return 0;
+    }
+
+    bool tilelayer::set(unsigned int p_x, unsigned int p_y, uint32_t p_gid) {
+        if (p_x >= _width || p_y >= _height)
+            return false;
+
+        if ((p_gid & TMX_GID_MASK) > _maxgid)
+            _maxgid = p_gid & TMX_GID_MASK;
+
+        if (gid(p_x, p_y) == p_gid)
+            return true;
+        _revs[(p_y / TMX_CHUNK_SIZE) * chunksX() + p_x / TMX_CHUNK_SIZE]++;
+
+        const uint32_t i = p_y * _width + p_x;
+        switch (_store) {
+        case eStore::dense32:
+            _dense32[i] = p_gid;
+            break;
+        case eStore::dense16:
+            // Widen the layer if the gid doesn't fit.
+            if ((p_gid & TMX_GID_MASK) > TMX_DENSE16_MAX) {
+                convert(eStore::dense32);
+                _dense32[i] = p_gid;
+            }
+            else
+                _dense16[i] = pack16(p_gid);
+            break;
+        case eStore::rle: {
+            // Re-encode the row with the new gid.
+            std::vector<uint32_t> row(_width);
+            readRow(p_y, 0, _width, row.data());
+            row[p_x] = p_gid;
+
+            std::vector<sRun> runs;
+            for (uint32_t x = 0; x < _width; x++)
+                if (x == 0 || row[x] != row[x - 1])
+                    runs.push_back({x, row[x]});
+
+            const uint32_t first = _rows[p_y], last = _rows[p_y + 1];
+            const int32_t delta = (int32_t)runs.size() - (int32_t)(last - first);
+            _runs.erase(_runs.begin() + first, _runs.begin() + last);
+            _runs.insert(_runs.begin() + first, runs.begin(), runs.end());
+            for (unsigned int r = p_y + 1; r <= _height; r++)
+                _rows[r] += delta;
+            break;
+        }
+        case eStore::sparse:
+            if (p_gid == 0) {
+                _bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+                _sparse.erase(i);
+            }
+            else {
+                _bits[i >> 6] |= (uint64_t)1 << (i & 63);
+                _sparse[i] = p_gid;
+            }
+            break;
+        }
+        return true;
+    }
+
+    void tilelayer::read(
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h,
+        uint32_t* p_out
+    ) const {
+        // Only the columns within the layer are decoded, the rest are empty.
+        const unsigned int x1 = (p_x < _width) ?
+                                p_x + std::min(p_w, _width - p_x) : p_x;
+        for (unsigned int y = 0; y < p_h; y++) {
+            uint32_t* out = p_out + (size_t)y * p_w;
+
+            // Rows outside of the layer are empty.
+            if (p_y + y >= _height) {
+                for (unsigned int x = 0; x < p_w; x++)
+                    out[x] = 0;
+                continue;
+            }
+
+            if (x1 > p_x)
+                readRow(p_y + y, p_x, x1, out);
+            for (unsigned int x = x1 - p_x; x < p_w; x++)
+                out[x] = 0;
+        }
+    }
+
+    bool tilelayer::convert(eStore p_store) {
+        if (p_store == _store)
+            return true;
+        if (p_store == eStore::dense16 && _maxgid > TMX_DENSE16_MAX)
+            return false;
+
+        std::vector<uint32_t> gids((size_t)_width * _height);
+        read(0, 0, _width, _height, gids.data());
+        build(gids.data(), p_store);
+        return true;
+    }
+
+    void tilelayer::optimize() {
+        std::vector<uint32_t> gids((size_t)_width * _height);
+        read(0, 0, _width, _height, gids.data());
+        build(gids.data(), choose(gids.data()));
+    }
+
+    unsigned int tilelayer::chunksX() const {
+        return (_width + TMX_CHUNK_SIZE - 1) / TMX_CHUNK_SIZE;
+    }
+
+    unsigned int tilelayer::chunksY() const {
+        return (_height + TMX_CHUNK_SIZE - 1) / TMX_CHUNK_SIZE;
+    }
+
+    uint32_t tilelayer::revision(unsigned int p_cx, unsigned int p_cy) const {
+        if (p_cx >= chunksX() || p_cy >= chunksY())
+            return 0;
+        return _revs[p_cy * chunksX() + p_cx];
+    }
+
+    uint64_t tilelayer::revision(
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h
+    ) const {
+        if (p_w == 0 || p_h == 0)
+            return 0;
+
+        uint64_t sum = 0;
+        for (unsigned int cy = p_y / TMX_CHUNK_SIZE;
+            cy <= (p_y + p_h - 1) / TMX_CHUNK_SIZE && cy < chunksY();
+            cy++
+        )
+            for (unsigned int cx = p_x / TMX_CHUNK_SIZE;
+                cx <= (p_x + p_w - 1) / TMX_CHUNK_SIZE && cx < chunksX();
+                cx++
+            )
+                sum += _revs[cy * chunksX() + cx];
+        return sum;
+    }
+
+    size_t tilelayer::count() const {
+        size_t n = 0;
+        switch (_store) {
+        case eStore::dense32:
+            for (size_t i = 0; i < _dense32.size(); i++)
+                n += (_dense32[i] != 0);
+            break;
+        case eStore::dense16:
+            for (size_t i = 0; i < _dense16.size(); i++)
+                n += (_dense16[i] != 0);
+            break;
+        case eStore::rle:
+            for (unsigned int y = 0; y < _height; y++)
+                for (uint32_t r = _rows[y]; r < _rows[y + 1]; r++)
+                    if (_runs[r].gid != 0)
+                        n += ((r + 1 < _rows[y + 1]) ? _runs[r + 1].x : _width)
+                             - _runs[r].x;
+            break;
+        case eStore::sparse:
+            n = _sparse.size();
+            break;
+        }
+        return n;
+    }
+
+    size_t tilelayer::memory() const {
+        // Hash nodes hold a key, a value and a link, plus one bucket each.
+        const size_t node = sizeof(void*) * 2 + sizeof(uint32_t) * 2;
+
+        return _dense32.capacity() * sizeof(uint32_t)
+             + _dense16.capacity() * sizeof(uint16_t)
+             + _runs.capacity() * sizeof(sRun)
+             + _rows.capacity() * sizeof(uint32_t)
+             + _bits.capacity() * sizeof(uint64_t)
+             + _sparse.size() * node
+             + _sparse.bucket_count() * sizeof(void*);
+    }
+
+    void tilelayer::clear() {
+        std::vector<uint32_t>().swap(_dense32);
+        std::vector<uint16_t>().swap(_dense16);
+        std::vector<sRun>().swap(_runs);
+        std::vector<uint32_t>().swap(_rows);
+        std::vector<uint64_t>().swap(_bits);
+        std::unordered_map<uint32_t, uint32_t>().swap(_sparse);
+    }
+
+    template<typename T>
+    void tilelayer::build(const T* p_gids, eStore p_store) {
+        clear();
+        _store = p_store;
+
+        const size_t n = (size_t)_width * _height;
+        switch (_store) {
+        case eStore::dense32:
+            _dense32.resize(n);
+            for (size_t i = 0; i < n; i++)
+                _dense32[i] = gidOf(p_gids[i]);
+            break;
+        case eStore::dense16:
+            _dense16.resize(n);
+            for (size_t i = 0; i < n; i++)
+                _dense16[i] = packedOf(p_gids[i]);
+            break;
+        case eStore::rle:
+            _rows.resize(_height + 1);
+            for (unsigned int y = 0; y < _height; y++) {
+                const T* row = p_gids + (size_t)y * _width;
+                _rows[y] = _runs.size();
+                for (uint32_t x = 0; x < _width; x++)
+                    if (x == 0 || row[x] != row[x - 1])
+                        _runs.push_back({x, gidOf(row[x])});
+            }
+            _rows[_height] = _runs.size();
+            _runs.shrink_to_fit();
+            break;
+        case eStore::sparse:
+            _bits.resize((n + 63) / 64);
+            for (size_t i = 0; i < n; i++)
+                if (p_gids[i] != 0) {
+                    _bits[i >> 6] |= (uint64_t)1 << (i & 63);
+                    _sparse[i] = gidOf(p_gids[i]);
+                }
+            break;
+        }
+    }
+
+    template<typename T>
+    eStore tilelayer::choose(const T* p_gids) const {
+        const size_t n = (size_t)_width * _height;
+
+        // Measure the layer's density and how well its rows compress.
+        size_t used = 0, runs = 0;
+        for (unsigned int y = 0; y < _height; y++) {
+            const T* row = p_gids + (size_t)y * _width;
+            for (uint32_t x = 0; x < _width; x++) {
+                used += (row[x] != 0);
+                runs += (x == 0 || row[x] != row[x - 1]);
+            }
+        }
+
+        // Estimated size in bytes of each representation.
+        const size_t dense = (_maxgid <= TMX_DENSE16_MAX) ? n * 2 : n * 4;
+        const size_t rle = runs * sizeof(sRun) + (_height + 1) * 4;
+        const size_t sparse = n / 8 + used * (sizeof(void*) * 3 + 8);
+
+        // Dense storage is the fastest to access, only trade it away if
+        // the alternative is less than half its size.
+        if (sparse * 2 < dense && sparse <= rle)
+            return eStore::sparse;
+        if (rle * 2 < dense)
+            return eStore::rle;
+        return (_maxgid <= TMX_DENSE16_MAX) ? eStore::dense16 : eStore::dense32;
+    }
+
+    void tilelayer::readRow(
+        unsigned int p_y,
+        unsigned int p_x0,
+        unsigned int p_x1,
+        uint32_t* p_out
+    ) const {
+        const size_t base = (size_t)p_y * _width;
+        switch (_store) {
+        case eStore::dense32:
+            for (unsigned int x = p_x0; x < p_x1; x++)
+                p_out[x - p_x0] = _dense32[base + x];
+            break;
+        case eStore::dense16:
+            for (unsigned int x = p_x0; x < p_x1; x++)
+                p_out[x - p_x0] = unpack16(_dense16[base + x]);
+            break;
+        case eStore::rle: {
+            // Binary search the row's runs for the one holding p_x0.
+            uint32_t lo = _rows[p_y], hi = _rows[p_y + 1];
+            while (hi - lo > 1) {
+                uint32_t mid = (lo + hi) / 2;
+                if (_runs[mid].x <= p_x0) lo = mid;
+                else hi = mid;
+            }
+            for (uint32_t r = lo, x = p_x0; x < p_x1; r++) {
+                const uint32_t end = std::min<uint32_t>(p_x1,
+                    (r + 1 < _rows[p_y + 1]) ? _runs[r + 1].x : _width);
+                for (; x < end; x++)
+                    p_out[x - p_x0] = _runs[r].gid;
+            }
+            break;
+        }
+        case eStore::sparse: {
+            for (unsigned int x = p_x0; x < p_x1; x++)
+                p_out[x - p_x0] = 0;
+
+            // Only the bitmap words overlapping the columns are walked.
+            const size_t first = base + p_x0, last = base + p_x1;
+            for (size_t w = first >> 6; w <= (last - 1) >> 6; w++) {
+                uint64_t m = _bits[w];
+                if (w == first >> 6)
+                    m &= ~(uint64_t)0 << (first & 63);
+                if (w == (last - 1) >> 6 && (last & 63) != 0)
+                    m &= ~(~(uint64_t)0 << (last & 63));
+                for (; m != 0; m &= m - 1) {
+                    const size_t i = (w << 6) + __builtin_ctzll(m);
+                    p_out[i - first] = _sparse.find((uint32_t)i)->second;
+                }
+            }
+            break;
+        }
+        }
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef LM_TMX_LAYER_H
+#define LM_TMX_LAYER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include <unordered_map>
+
+/**============================================================================
+ * Decoded tile layer data. The gids of a layer are kept in whichever of the
+ * available representations suits the layer's measured density best, all of
+ * which are reached through the same tile access functions.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_FLIP_H 0x80000000u //@- Gid flag: flipped horizontally.
+#define TMX_FLIP_V 0x40000000u //@- Gid flag: flipped vertically.
+#define TMX_FLIP_D 0x20000000u //@- Gid flag: flipped diagonally.
+#define TMX_GID_MASK 0x1FFFFFFFu //@- Gid bits without the flip flags.
+#define TMX_DENSE16_MAX 0x1FFFu //@- Highest gid of a packed 16-bit tile.
+#define TMX_CHUNK_SIZE 32 //@- Width & height in tiles of a layer chunk.
+
+namespace tmx {
+    // Tile layer storage representations.
+    enum eStore { dense32, dense16, rle, sparse };
+
+    class tilelayer {
+    public:
+        tilelayer();
+
+        /**
+         * Builds the layer from a dense array of gids, picking the
+         * representation from the data's density.
+         *
+         * @param p_gids Row-major gids, p_width * p_height of them.
+         * @param p_width Width of the layer in tiles.
+         * @param p_height Height of the layer in tiles.
+         * @param p_maxgid Highest gid (without flags) the layer may hold...
+         * ...defaults to the highest one found in p_gids.
+         */
+        tilelayer(
+            const uint32_t* p_gids,
+            unsigned int p_width,
+            unsigned int p_height,
+            uint32_t p_maxgid = 0
+        );
+
+        /**
+         * Builds the layer from a dense array of packed 16-bit gids, as
+         * written by the 16-bit layer data decoders. (see tmx_decode.h) The
+         * array is taken over as is if the layer stays dense16.
+         *
+         * @param p_packed Row-major packed gids, p_width * p_height of them.
+         * @param p_width Width of the layer in tiles.
+         * @param p_height Height of the layer in tiles.
+         * @param p_maxgid Highest gid (without flags) the layer may hold...
+         * ...defaults to the highest one found in p_packed.
+         */
+        tilelayer(
+            std::vector<uint16_t>&& p_packed,
+            unsigned int p_width,
+            unsigned int p_height,
+            uint32_t p_maxgid = 0
+        );
+
+        /** @returns [unsigned int] Width of the layer in tiles. */
+        unsigned int width() const;
+        /** @returns [unsigned int] Height of the layer in tiles. */
+        unsigned int height() const;
+        /** @returns [eStore] Representation currently in use. */
+        eStore store() const;
+
+        /**
+         * Get the gid, flip flags included, of the tile at given position.
+         *
+         * @param p_x Column of the tile.
+         * @param p_y Row of the tile.
+         * @returns [uint32_t] Gid of the tile, 0 if empty or out of bounds.
+         */
+        uint32_t gid(unsigned int p_x, unsigned int p_y) const;
+
+        /**
+         * Set the gid of the tile at given position. Dense 16-bit layers are
+         * widened if the gid doesn't fit, other representations are kept
+         * until optimize() is called.
+         *
+         * @param p_x Column of the tile.
+         * @param p_y Row of the tile.
+         * @param p_gid Gid to set, flip flags included.
+         * @returns [bool] Whether or not the position was within the layer.
+         */
+        bool set(unsigned int p_x, unsigned int p_y, uint32_t p_gid);
+
+        /**
+         * Copy a rectangle of gids into a row-major array. Tiles outside of
+         * the layer are read as 0.
+         *
+         * @param p_x Left column of the rectangle.
+         * @param p_y Top row of the rectangle.
+         * @param p_w Width of the rectangle.
+         * @param p_h Height of the rectangle.
+         * @param p_out Array of at least p_w * p_h gids to write to.
+         */
+        void read(
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h,
+            uint32_t* p_out
+        ) const;
+
+        /**
+         * Convert the layer to the given representation. Converting to
+         * dense16 fails if any gid doesn't fit.
+         *
+         * @param p_store Representation to convert to.
+         * @returns [bool] Whether or not the layer was converted.
+         */
+        bool convert(eStore p_store);
+
+        /** Re-evaluate the layer's density and pick its representation. */
+        void optimize();
+
+        /** @returns [unsigned int] Number of chunk columns in the layer. */
+        unsigned int chunksX() const;
+        /** @returns [unsigned int] Number of chunk rows in the layer. */
+        unsigned int chunksY() const;
+
+        /**
+         * Get the revision of a TMX_CHUNK_SIZE square chunk of the layer.
+         * The revision grows each time one of the chunk's tiles changes.
+         *
+         * @param p_cx Chunk column.
+         * @param p_cy Chunk row.
+         * @returns [uint32_t] Revision of the chunk.
+         */
+        uint32_t revision(unsigned int p_cx, unsigned int p_cy) const;
+
+        /**
+         * Sum of the revisions of all chunks overlapping a tile rectangle.
+         * Changes whenever any tile within the rectangle changes.
+         *
+         * @param p_x Left column of the rectangle.
+         * @param p_y Top row of the rectangle.
+         * @param p_w Width of the rectangle.
+         * @param p_h Height of the rectangle.
+         * @returns [uint64_t] Revision stamp of the rectangle.
+         */
+        uint64_t revision(
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h
+        ) const;
+
+        /** @returns [size_t] Number of non-empty tiles. */
+        size_t count() const;
+        /** @returns [size_t] Bytes of memory used by the tile storage. */
+        size_t memory() const;
+    private:
+        // Horizontal run of one gid in a row.
+        struct sRun { uint32_t x; uint32_t gid; };
+
+        void clear();
+        // Dense gids are either uint32_t or packed uint16_t.
+        template<typename T> void build(const T* p_gids, eStore p_store);
+        template<typename T> eStore choose(const T* p_gids) const;
+        // Decodes columns [p_x0, p_x1) of a row, both within the layer.
+        void readRow(
+            unsigned int p_y,
+            unsigned int p_x0,
+            unsigned int p_x1,
+            uint32_t* p_out
+        ) const;
+
+        unsigned int _width; //@- Width in tiles.
+        unsigned int _height; //@- Height in tiles.
+        uint32_t _maxgid; //@- Highest gid the layer may hold.
+        eStore _store; //@- Representation in use.
+        std::vector<uint32_t> _revs; //@- Revision of each chunk.
+
+        std::vector<uint32_t> _dense32; //@- eStore::dense32 gids.
+        std::vector<uint16_t> _dense16; //@- eStore::dense16 packed gids.
+        std::vector<sRun> _runs; //@- eStore::rle runs, row after row.
+        std::vector<uint32_t> _rows; //@- eStore::rle first run of each row.
+        std::vector<uint64_t> _bits; //@- eStore::sparse occupancy bitmap.
+        std::unordered_map<uint32_t, uint32_t> _sparse; //@- eStore::sparse.
+    };
+}
+
+#endif
@@ -0,0 +1,515 @@
+#include <queue>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include "tmx_nav.h"
+#include "tmx_tileset.h"
+#include "tmx_utils.h"
+
+#define TMX_NAV_NONE 0xFFFFFFFFu //@- Unreached distance / missing node.
+#define TMX_NAV_START 0xFFFFFFFEu //@- Abstract search start marker.
+#define TMX_NAV_GOAL 0xFFFFFFFDu //@- Abstract search goal marker.
+
+namespace tmx {
+    navgrid::navgrid() {
+        _width = 0;
+        _height = 0;
+        _csize = 1;
+        _ccols = 0;
+        _crows = 0;
+        _default = true;
+    }
+
+    navgrid::navgrid(
+        sNode& p_map,
+        const std::vector<sWalkRule>& p_rules,
+        bool p_default,
+        unsigned int p_cluster
+    ) {
+        _width = valInt(getNodeVar(p_map, "width"));
+        _height = valInt(getNodeVar(p_map, "height"));
+        _csize = std::max(2u, p_cluster);
+        _ccols = (_width + _csize - 1) / _csize;
+        _crows = (_height + _csize - 1) / _csize;
+        _default = p_default;
+
+        _bits.assign(((size_t)_width * _height + 63) / 64, 0);
+        _override.assign((size_t)_width * _height, 0);
+        _dirty.assign((size_t)_ccols * _crows, 1);
+        _clusters.resize((size_t)_ccols * _crows);
+
+        std::vector<sTileset> sets = loadTilesets(p_map);
+        const uint32_t maxgid = maxGid(sets);
+
+        // Bind each rule to the layers it tests.
+        for (unsigned int r = 0; r < p_rules.size(); r++) {
+            const sWalkRule& rule = p_rules.at(r);
+
+            // Gids whose tile matches the rule's property.
+            std::vector<char> match;
+            if (!rule.prop.empty()) {
+                match.assign(maxgid + 1, 0);
+                for (unsigned int s = 0; s < sets.size(); s++)
+                    for (auto it = sets[s].node->nodes; it; it = it->next()) {
+                        sNode& tile = *it->valptr();
+                        if (tile.tag != eTag::tile)
+                            continue;
+
+                        const long id = valInt(getNodeVar(tile, "id"), -1);
+                        sVal v = getNodeVar(tile, rule.prop, true);
+                        if (id < 0 || (uint32_t)id >= sets[s].count ||
+                            v.type == eType::error)
+                            continue;
+                        if (rule.value.empty() || v.value == rule.value)
+                            match[sets[s].firstgid + id] = 1;
+                    }
+            }
+
+            for (auto it = p_map.nodes; it; it = it->next()) {
+                sNode& layer = *it->valptr();
+                if (layer.tag != eTag::layer)
+                    continue;
+                if (!rule.layer.empty() &&
+                    getNodeVar(layer, "name").value != rule.layer)
+                    continue;
+
+                for (auto d = layer.nodes; d; d = d->next())
+                    if (d->valptr()->tag == eTag::data &&
+                        d->valptr()->data && d->valptr()->data->tiles) {
+                        sBoundRule b;
+                        b.tiles = d->valptr()->data->tiles;
+                        b.match = match;
+                        b.walkable = rule.walkable;
+                        _rules.push_back(b);
+
+                        if (std::find(_layers.begin(), _layers.end(), b.tiles)
+                            == _layers.end()) {
+                            _layers.push_back(b.tiles);
+                            _revs.push_back(std::vector<uint32_t>(
+                                (size_t)b.tiles->chunksX() * b.tiles->chunksY()
+                            ));
+                        }
+                    }
+            }
+        }
+
+        // Record the layers' current revisions and evaluate the whole grid.
+        for (unsigned int l = 0; l < _layers.size(); l++)
+            for (unsigned int cy = 0; cy < _layers[l]->chunksY(); cy++)
+                for (unsigned int cx = 0; cx < _layers[l]->chunksX(); cx++)
+                    _revs[l][cy * _layers[l]->chunksX() + cx] =
+                        _layers[l]->revision(cx, cy);
+
+        evalRect(0, 0, _width, _height);
+        update();
+    }
+
+    unsigned int navgrid::width() const { return _width; }
+    unsigned int navgrid::height() const { return _height; }
+
+    bool navgrid::walkable(int p_x, int p_y) const {
+        if (p_x < 0 || p_y < 0 ||
+            (unsigned int)p_x >= _width || (unsigned int)p_y >= _height)
+            return false;
+        return cell(p_y * _width + p_x);
+    }
+
+    void navgrid::setWalkable(int p_x, int p_y, bool p_walkable) {
+        if (p_x < 0 || p_y < 0 ||
+            (unsigned int)p_x >= _width || (unsigned int)p_y >= _height)
+            return;
+        // Only recorded here, findPath(s) may be reading the grid.
+        _override[p_y * _width + p_x] = p_walkable ? 2 : 1;
+        _pending.push_back(p_y * _width + p_x);
+    }
+
+    unsigned int navgrid::update(unsigned int p_threads) {
+        // Re-apply the rules to layer chunks that changed.
+        for (unsigned int l = 0; l < _layers.size(); l++) {
+            const tilelayer* t = _layers[l];
+            for (unsigned int cy = 0; cy < t->chunksY(); cy++)
+                for (unsigned int cx = 0; cx < t->chunksX(); cx++) {
+                    uint32_t& rev = _revs[l][cy * t->chunksX() + cx];
+                    if (rev == t->revision(cx, cy))
+                        continue;
+                    rev = t->revision(cx, cy);
+                    evalRect(cx * TMX_CHUNK_SIZE, cy * TMX_CHUNK_SIZE,
+                             TMX_CHUNK_SIZE, TMX_CHUNK_SIZE);
+                }
+        }
+
+        // Apply the overrides set since the last update.
+        for (unsigned int i = 0; i < _pending.size(); i++)
+            evalRect(_pending[i] % _width, _pending[i] / _width, 1, 1);
+        _pending.clear();
+
+        // Entrances on the borders of changed clusters move, so their
+        // neighbours are rebuilt alongside them.
+        std::vector<char> rebuild(_clusters.size(), 0);
+        for (unsigned int c = 0; c < _clusters.size(); c++) {
+            if (!_dirty[c])
+                continue;
+            const unsigned int cx = c % _ccols, cy = c / _ccols;
+            rebuild[c] = 1;
+            if (cx > 0) rebuild[c - 1] = 1;
+            if (cx + 1 < _ccols) rebuild[c + 1] = 1;
+            if (cy > 0) rebuild[c - _ccols] = 1;
+            if (cy + 1 < _crows) rebuild[c + _ccols] = 1;
+            _dirty[c] = 0;
+        }
+
+        std::vector<unsigned int> list;
+        for (unsigned int c = 0; c < rebuild.size(); c++)
+            if (rebuild[c])
+                list.push_back(c);
+
+        parallelFor(list.size(), [&](size_t i) {
+            buildCluster(list.at(i));
+        }, p_threads);
+
+        return list.size();
+    }
+
+    std::vector<sPoint> navgrid::findPath(sPoint p_from, sPoint p_to) const {
+        std::vector<sPoint> path;
+        if (!walkable(p_from.x, p_from.y) || !walkable(p_to.x, p_to.y))
+            return path;
+
+        const uint32_t from = p_from.y * _width + p_from.x;
+        const uint32_t to = p_to.y * _width + p_to.x;
+        const unsigned int sc = (p_from.y / _csize) * _ccols + p_from.x / _csize;
+        const unsigned int gc = (p_to.y / _csize) * _ccols + p_to.x / _csize;
+
+        // Both ends within one cluster, try staying inside it first.
+        if (sc == gc && clusterPath(from, to, path))
+            return path;
+
+        // Link the start & goal to the entrances of their clusters.
+        std::vector<uint32_t> sdist, gdist;
+        clusterBFS(sc, from, sdist);
+        clusterBFS(gc, to, gdist);
+
+        const unsigned int gx0 = (gc % _ccols) * _csize;
+        const unsigned int gy0 = (gc / _ccols) * _csize;
+        auto goalDist = [&](uint32_t p_cell) -> uint32_t {
+            const unsigned int x = p_cell % _width - gx0;
+            const unsigned int y = p_cell / _width - gy0;
+            return gdist[y * _csize + x];
+        };
+        auto heuristic = [&](uint32_t p_cell) -> uint32_t {
+            const int dx = (int)(p_cell % _width) - p_to.x;
+            const int dy = (int)(p_cell / _width) - p_to.y;
+            return std::abs(dx) + std::abs(dy);
+        };
+
+        // A* over the entrances. (f, g, cell)
+        typedef std::pair<uint32_t, std::pair<uint32_t, uint32_t>> entry;
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+        std::unordered_map<uint32_t, uint32_t> g, parent;
+
+        auto relax = [&](uint32_t p_cell, uint32_t p_g, uint32_t p_parent) {
+            auto it = g.find(p_cell);
+            if (it != g.end() && it->second <= p_g)
+                return;
+            g[p_cell] = p_g;
+            parent[p_cell] = p_parent;
+            const uint32_t h = (p_cell == TMX_NAV_GOAL) ? 0 : heuristic(p_cell);
+            open.push({p_g + h, {p_g, p_cell}});
+        };
+
+        const sCluster& start = _clusters[sc];
+        for (unsigned int i = 0; i < start.nodes.size(); i++) {
+            const uint32_t n = start.nodes[i];
+            const unsigned int x = n % _width - (sc % _ccols) * _csize;
+            const unsigned int y = n / _width - (sc / _ccols) * _csize;
+            if (sdist[y * _csize + x] != TMX_NAV_NONE)
+                relax(n, sdist[y * _csize + x], TMX_NAV_START);
+        }
+
+        bool found = false;
+        while (!open.empty()) {
+            const uint32_t cg = open.top().second.first;
+            const uint32_t cur = open.top().second.second;
+            open.pop();
+            if (g[cur] < cg)
+                continue;
+            if (cur == TMX_NAV_GOAL) {
+                found = true;
+                break;
+            }
+
+            const unsigned int c = ((cur / _width) / _csize) * _ccols +
+                                   (cur % _width) / _csize;
+            const int local = localNode(c, cur);
+            if (local < 0)
+                continue;
+
+            const std::vector<sEdge>& edges = _clusters[c].edges[local];
+            for (unsigned int e = 0; e < edges.size(); e++)
+                relax(edges[e].to, cg + edges[e].cost, cur);
+
+            if (c == gc && goalDist(cur) != TMX_NAV_NONE)
+                relax(TMX_NAV_GOAL, cg + goalDist(cur), cur);
+        }
+        if (!found)
+            return path;
+
+        // Walk back to the start, then refine each abstract step.
+        std::vector<uint32_t> steps;
+        steps.push_back(to);
+        for (uint32_t c = parent[TMX_NAV_GOAL]; c != TMX_NAV_START; c = parent[c])
+            steps.push_back(c);
+        steps.push_back(from);
+        std::reverse(steps.begin(), steps.end());
+
+        path.push_back(p_from);
+        for (unsigned int i = 1; i < steps.size(); i++) {
+            const uint32_t a = steps[i - 1], b = steps[i];
+            const int dx = (int)(b % _width) - (int)(a % _width);
+            const int dy = (int)(b / _width) - (int)(a / _width);
+
+            // Entrance pairs are neighbours across a cluster border.
+            if (std::abs(dx) + std::abs(dy) == 1) {
+                path.push_back({(int)(b % _width), (int)(b / _width)});
+                continue;
+            }
+
+            std::vector<sPoint> part;
+            if (!clusterPath(a, b, part))
+                return std::vector<sPoint>();
+            path.insert(path.end(), part.begin() + 1, part.end());
+        }
+        return path;
+    }
+
+    void navgrid::findPaths(
+        const std::vector<sPathQuery>& p_queries,
+        std::vector<std::vector<sPoint>>& p_out,
+        unsigned int p_threads
+    ) const {
+        p_out.resize(p_queries.size());
+        parallelFor(p_queries.size(), [&](size_t i) {
+            p_out[i] = findPath(p_queries[i].from, p_queries[i].to);
+        }, p_threads);
+    }
+
+    bool navgrid::cell(uint32_t p_i) const {
+        return (_bits[p_i >> 6] >> (p_i & 63)) & 1;
+    }
+
+    void navgrid::evalRect(
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h
+    ) {
+        for (unsigned int y = p_y; y < p_y + p_h && y < _height; y++)
+            for (unsigned int x = p_x; x < p_x + p_w && x < _width; x++) {
+                const uint32_t i = y * _width + x;
+
+                // The last matching rule wins, overrides beat the rules.
+                bool walk = _default;
+                for (unsigned int r = 0; r < _rules.size(); r++) {
+                    const uint32_t gid = _rules[r].tiles->gid(x, y) & TMX_GID_MASK;
+                    if (gid == 0)
+                        continue;
+                    if (_rules[r].match.empty() ||
+                        (gid < _rules[r].match.size() && _rules[r].match[gid]))
+                        walk = _rules[r].walkable;
+                }
+                if (_override[i] != 0)
+                    walk = (_override[i] == 2);
+
+                if (walk == cell(i))
+                    continue;
+                _bits[i >> 6] ^= (uint64_t)1 << (i & 63);
+                markDirty(x, y);
+            }
+    }
+
+    void navgrid::markDirty(unsigned int p_x, unsigned int p_y) {
+        _dirty[(p_y / _csize) * _ccols + p_x / _csize] = 1;
+    }
+
+    void navgrid::buildCluster(unsigned int p_c) {
+        sCluster& cl = _clusters[p_c];
+        cl.nodes.clear();
+        cl.edges.clear();
+
+        const unsigned int cx = p_c % _ccols, cy = p_c / _ccols;
+
+        // Entrance pairs on all four borders. (cell here, cell across)
+        std::vector<uint32_t> pairs, tmp;
+        entrances(p_c, 0, pairs);
+        entrances(p_c, 1, pairs);
+        if (cx > 0) {
+            entrances(p_c - 1, 0, tmp);
+            for (unsigned int i = 0; i < tmp.size(); i += 2) {
+                pairs.push_back(tmp[i + 1]);
+                pairs.push_back(tmp[i]);
+            }
+            tmp.clear();
+        }
+        if (cy > 0) {
+            entrances(p_c - _ccols, 1, tmp);
+            for (unsigned int i = 0; i < tmp.size(); i += 2) {
+                pairs.push_back(tmp[i + 1]);
+                pairs.push_back(tmp[i]);
+            }
+        }
+
+        for (unsigned int i = 0; i < pairs.size(); i += 2) {
+            int n = localNode(p_c, pairs[i]);
+            if (n < 0) {
+                n = cl.nodes.size();
+                cl.nodes.push_back(pairs[i]);
+                cl.edges.push_back(std::vector<sEdge>());
+            }
+            cl.edges[n].push_back({pairs[i + 1], 1});
+        }
+
+        // Connect the cluster's entrances to each other.
+        const unsigned int x0 = cx * _csize, y0 = cy * _csize;
+        std::vector<uint32_t> dist;
+        for (unsigned int i = 0; i < cl.nodes.size(); i++) {
+            clusterBFS(p_c, cl.nodes[i], dist);
+            for (unsigned int j = 0; j < cl.nodes.size(); j++) {
+                if (i == j)
+                    continue;
+                const unsigned int x = cl.nodes[j] % _width - x0;
+                const unsigned int y = cl.nodes[j] / _width - y0;
+                if (dist[y * _csize + x] != TMX_NAV_NONE)
+                    cl.edges[i].push_back({cl.nodes[j], dist[y * _csize + x]});
+            }
+        }
+    }
+
+    void navgrid::entrances(
+        unsigned int p_c,
+        unsigned int p_side,
+        std::vector<uint32_t>& p_out
+    ) const {
+        const unsigned int cx = p_c % _ccols, cy = p_c / _ccols;
+        if ((p_side == 0 && cx + 1 >= _ccols) || (p_side == 1 && cy + 1 >= _crows))
+            return;
+
+        // Walk along the border (right side = 0, bottom side = 1).
+        const unsigned int len = (p_side == 0)
+            ? std::min(_csize, _height - cy * _csize)
+            : std::min(_csize, _width - cx * _csize);
+        auto here = [&](unsigned int p_i) -> uint32_t {
+            if (p_side == 0)
+                return (cy * _csize + p_i) * _width + cx * _csize + _csize - 1;
+            return (cy * _csize + _csize - 1) * _width + cx * _csize + p_i;
+        };
+        const uint32_t step = (p_side == 0) ? 1 : _width;
+
+        // Each run of open pairs gets an entrance in its middle, long runs
+        // get one at each end instead.
+        unsigned int run = 0;
+        for (unsigned int i = 0; i <= len; i++) {
+            if (i < len && cell(here(i)) && cell(here(i) + step)) {
+                run++;
+                continue;
+            }
+            if (run == 0)
+                continue;
+
+            const unsigned int first = i - run, last = i - 1;
+            if (run < 6) {
+                p_out.push_back(here((first + last) / 2));
+                p_out.push_back(here((first + last) / 2) + step);
+            }
+            else {
+                p_out.push_back(here(first));
+                p_out.push_back(here(first) + step);
+                p_out.push_back(here(last));
+                p_out.push_back(here(last) + step);
+            }
+            run = 0;
+        }
+    }
+
+    int navgrid::localNode(unsigned int p_c, uint32_t p_cell) const {
+        const std::vector<uint32_t>& nodes = _clusters[p_c].nodes;
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            if (nodes[i] == p_cell)
+                return i;
+        return -1;
+    }
+
+    void navgrid::clusterBFS(
+        unsigned int p_c,
+        uint32_t p_from,
+        std::vector<uint32_t>& p_dist
+    ) const {
+        const unsigned int x0 = (p_c % _ccols) * _csize;
+        const unsigned int y0 = (p_c / _ccols) * _csize;
+        const unsigned int w = std::min(_csize, _width - x0);
+        const unsigned int h = std::min(_csize, _height - y0);
+
+        p_dist.assign((size_t)_csize * _csize, TMX_NAV_NONE);
+        std::vector<uint32_t> queue;
+        queue.push_back((p_from / _width - y0) * _csize + p_from % _width - x0);
+        p_dist[queue.front()] = 0;
+
+        for (unsigned int q = 0; q < queue.size(); q++) {
+            const unsigned int x = queue[q] % _csize, y = queue[q] / _csize;
+            const uint32_t d = p_dist[queue[q]] + 1;
+            const int nx[4] = { (int)x - 1, (int)x + 1, (int)x, (int)x };
+            const int ny[4] = { (int)y, (int)y, (int)y - 1, (int)y + 1 };
+
+            for (unsigned int n = 0; n < 4; n++) {
+                if (nx[n] < 0 || ny[n] < 0 ||
+                    (unsigned int)nx[n] >= w || (unsigned int)ny[n] >= h)
+                    continue;
+                const uint32_t l = ny[n] * _csize + nx[n];
+                if (p_dist[l] != TMX_NAV_NONE ||
+                    !cell((y0 + ny[n]) * _width + x0 + nx[n]))
+                    continue;
+                p_dist[l] = d;
+                queue.push_back(l);
+            }
+        }
+    }
+
+    bool navgrid::clusterPath(
+        uint32_t p_from,
+        uint32_t p_to,
+        std::vector<sPoint>& p_out
+    ) const {
+        const unsigned int c = ((p_from / _width) / _csize) * _ccols +
+                               (p_from % _width) / _csize;
+        const unsigned int x0 = (c % _ccols) * _csize;
+        const unsigned int y0 = (c / _ccols) * _csize;
+
+        // Search back from the goal, then follow the distances down.
+        std::vector<uint32_t> dist;
+        clusterBFS(c, p_to, dist);
+
+        int x = p_from % _width - x0, y = p_from / _width - y0;
+        if (dist[y * _csize + x] == TMX_NAV_NONE)
+            return false;
+
+        p_out.clear();
+        p_out.push_back({(int)(x + x0), (int)(y + y0)});
+        while (dist[y * _csize + x] != 0) {
+            const uint32_t d = dist[y * _csize + x];
+            const int nx[4] = { x - 1, x + 1, x, x };
+            const int ny[4] = { y, y, y - 1, y + 1 };
+            for (unsigned int n = 0; n < 4; n++) {
+                if (nx[n] < 0 || ny[n] < 0 ||
+                    nx[n] >= (int)_csize || ny[n] >= (int)_csize)
+                    continue;
+                if (dist[ny[n] * _csize + nx[n]] == d - 1) {
+                    x = nx[n];
+                    y = ny[n];
+                    break;
+                }
+            }
+            p_out.push_back({(int)(x + x0), (int)(y + y0)});
+        }
+        return true;
+    }
+}
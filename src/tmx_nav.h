@@ -0,0 +1,164 @@
+#ifndef LM_TMX_NAV_H
+#define LM_TMX_NAV_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Navigation grid derived from tile layers, with a hierarchical abstraction
+ * (HPA*) on top of it. The grid is split into square clusters connected by
+ * entrances on their borders, path queries are searched over the entrances
+ * and refined cluster by cluster.
+ *
+ * Movement is 4-connected with a cost of 1 per step.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Walkability rule, rules are applied in order and the last match wins.
+    struct sWalkRule {
+        std::string layer; //@- Name of the layer to test, "" = every layer.
+        std::string prop; //@- Tile property to test, "" = any non-empty tile.
+        std::string value; //@- Property value to match, "" = any value.
+        bool walkable; //@- Walkability of matching cells.
+    };
+
+    // Grid point structure.
+    struct sPoint { int x; int y; };
+
+    // Path query structure.
+    struct sPathQuery { sPoint from; sPoint to; };
+
+    class navgrid {
+    public:
+        navgrid();
+
+        /**
+         * Builds the walkability grid of a map from the given rules, and its
+         * cluster abstraction.
+         *
+         * @param p_map The root <map> node.
+         * @param p_rules Rules deciding which cells are walkable.
+         * @param p_default Walkability of cells no rule matches.
+         * @param p_cluster Width & height of the clusters in cells.
+         */
+        navgrid(
+            sNode& p_map,
+            const std::vector<sWalkRule>& p_rules,
+            bool p_default = true,
+            unsigned int p_cluster = 16
+        );
+
+        /** @returns [unsigned int] Width of the grid in cells. */
+        unsigned int width() const;
+        /** @returns [unsigned int] Height of the grid in cells. */
+        unsigned int height() const;
+
+        /**
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [bool] Whether the cell is walkable. (false outside)
+         */
+        bool walkable(int p_x, int p_y) const;
+
+        /**
+         * Overrides the walkability of a cell. Takes effect on the next
+         * update(), so it may be called while findPath(s) runs, but not
+         * from several threads at once.
+         *
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @param p_walkable New walkability of the cell.
+         */
+        void setWalkable(int p_x, int p_y, bool p_walkable);
+
+        /**
+         * Re-applies the rules to the layer chunks that changed since the
+         * last update and rebuilds the clusters around changed cells.
+         *
+         * !WARNING! Must not run alongside findPath(s).
+         *
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         * @returns [unsigned int] Number of clusters rebuilt.
+         */
+        unsigned int update(unsigned int p_threads = 0);
+
+        /**
+         * Finds a path between two cells. Safe to call from several threads.
+         *
+         * @param p_from Cell to start from.
+         * @param p_to Cell to reach.
+         * @returns [std::vector<sPoint>] Cells of the path, both ends...
+         * ...included. Empty if there is no path.
+         */
+        std::vector<sPoint> findPath(sPoint p_from, sPoint p_to) const;
+
+        /**
+         * Finds the paths of a batch of queries across several threads.
+         *
+         * @param p_queries Queries to answer.
+         * @param p_out Paths to write to, one per query.
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         */
+        void findPaths(
+            const std::vector<sPathQuery>& p_queries,
+            std::vector<std::vector<sPoint>>& p_out,
+            unsigned int p_threads = 0
+        ) const;
+    private:
+        // Abstract graph edge.
+        struct sEdge { uint32_t to; uint32_t cost; };
+
+        // Cluster of the abstraction, nodes are entrance cells.
+        struct sCluster {
+            std::vector<uint32_t> nodes;
+            std::vector<std::vector<sEdge>> edges;
+        };
+
+        // Rule bound to the tiles it tests.
+        struct sBoundRule {
+            const tilelayer* tiles;
+            std::vector<char> match; //@- Whether each gid matches.
+            bool walkable;
+        };
+
+        bool cell(uint32_t p_i) const;
+        void evalRect(unsigned int p_x, unsigned int p_y,
+                      unsigned int p_w, unsigned int p_h);
+        void markDirty(unsigned int p_x, unsigned int p_y);
+        void buildCluster(unsigned int p_c);
+        void entrances(unsigned int p_c, unsigned int p_side,
+                       std::vector<uint32_t>& p_out) const;
+        int localNode(unsigned int p_c, uint32_t p_cell) const;
+        void clusterBFS(unsigned int p_c, uint32_t p_from,
+                        std::vector<uint32_t>& p_dist) const;
+        bool clusterPath(uint32_t p_from, uint32_t p_to,
+                         std::vector<sPoint>& p_out) const;
+
+        unsigned int _width;
+        unsigned int _height;
+        unsigned int _csize; //@- Cluster size in cells.
+        unsigned int _ccols; //@- Cluster columns.
+        unsigned int _crows; //@- Cluster rows.
+        bool _default; //@- Walkability of cells no rule matches.
+
+        std::vector<uint64_t> _bits; //@- Walkability, 1 bit per cell.
+        std::vector<char> _override; //@- 0 = none, 1 = blocked, 2 = open.
+        std::vector<uint32_t> _pending; //@- Cells overridden since update.
+        std::vector<sBoundRule> _rules;
+        //@- Chunk revisions of each layer tested by the rules.
+        std::vector<std::vector<uint32_t>> _revs;
+        std::vector<const tilelayer*> _layers;
+        std::vector<char> _dirty; //@- Clusters needing a rebuild.
+        std::vector<sCluster> _clusters;
+    };
+}
+
+#endif
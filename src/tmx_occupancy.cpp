@@ -0,0 +1,275 @@
+#include <algorithm>
+
+#include "tmx_occupancy.h"
+#include "tmx_utils.h"
+
+namespace tmx {
+    occupancy::occupancy() {
+        _width = 0;
+        _height = 0;
+        _stride = 0;
+        _bytes = 1;
+        _visible = 0;
+    }
+
+    occupancy::occupancy(
+        sNode& p_map,
+        const std::vector<uint64_t>* p_gids,
+        unsigned int p_threads
+    ) {
+        _width = valInt(getNodeVar(p_map, "width"));
+        _height = valInt(getNodeVar(p_map, "height"));
+        _stride = (_width + 63) / 64;
+        _visible = 0;
+        if (p_gids != nullptr)
+            _gids = *p_gids;
+
+        for (auto it = p_map.nodes; it; it = it->next()) {
+            sNode& layer = *it->valptr();
+            if (layer.tag != eTag::layer)
+                continue;
+
+            for (auto d = layer.nodes; d; d = d->next()) {
+                sNode& data = *d->valptr();
+                if (data.tag != eTag::data || !data.data || !data.data->tiles)
+                    continue;
+                if (_layers.size() == TMX_OCC_MAX_LAYERS)
+                    break;
+
+                if (valInt(getNodeVar(layer, "visible"), 1) != 0 &&
+                    valDec(getNodeVar(layer, "opacity"), 1) > 0)
+                    _visible |= (uint64_t)1 << _layers.size();
+                _layers.push_back(data.data->tiles);
+            }
+        }
+
+        _bytes = std::max<size_t>(1, (_layers.size() + 7) / 8);
+        _bits.assign(_layers.size(),
+                     std::vector<uint64_t>((size_t)_stride * _height, 0));
+        _masks.assign((size_t)_width * _height * _bytes, 0);
+
+        // Start from revisions no chunk can have so update builds it all.
+        _revs.resize(_layers.size());
+        for (unsigned int l = 0; l < _layers.size(); l++)
+            _revs[l].assign(
+                (size_t)_layers[l]->chunksX() * _layers[l]->chunksY(),
+                UINT32_MAX
+            );
+        update(p_threads);
+    }
+
+    unsigned int occupancy::width() const { return _width; }
+    unsigned int occupancy::height() const { return _height; }
+    unsigned int occupancy::layers() const { return _layers.size(); }
+
+    const tilelayer* occupancy::layer(unsigned int p_layer) const {
+        return _layers.at(p_layer);
+    }
+
+    void occupancy::setVisible(unsigned int p_layer, bool p_visible) {
+        if (p_layer >= _layers.size())
+            return;
+        if (p_visible)
+            _visible |= (uint64_t)1 << p_layer;
+        else
+            _visible &= ~((uint64_t)1 << p_layer);
+    }
+
+    uint64_t occupancy::visible() const {
+        return _visible;
+    }
+
+    bool occupancy::occupied(unsigned int p_layer, int p_x, int p_y) const {
+        if (p_layer >= _layers.size() || p_x < 0 || p_y < 0 ||
+            (unsigned int)p_x >= _width || (unsigned int)p_y >= _height)
+            return false;
+        return (_bits[p_layer][(size_t)p_y * _stride + (p_x >> 6)] >>
+                (p_x & 63)) & 1;
+    }
+
+    uint64_t occupancy::mask(int p_x, int p_y) const {
+        if (p_x < 0 || p_y < 0 ||
+            (unsigned int)p_x >= _width || (unsigned int)p_y >= _height)
+            return 0;
+
+        const uint8_t* m = &_masks[((size_t)p_y * _width + p_x) * _bytes];
+        uint64_t v = 0;
+        for (unsigned int b = 0; b < _bytes; b++)
+            v |= (uint64_t)m[b] << (b * 8);
+        return v;
+    }
+
+    int occupancy::topmost(int p_x, int p_y) const {
+        const uint64_t m = mask(p_x, p_y) & _visible;
+        return m ? 63 - __builtin_clzll(m) : -1;
+    }
+
+    uint32_t occupancy::topmostGid(int p_x, int p_y) const {
+        const int l = topmost(p_x, p_y);
+        return (l < 0) ? 0 : _layers[l]->gid(p_x, p_y);
+    }
+
+    bool occupancy::any(unsigned int p_layer, int p_x, int p_y,
+                        unsigned int p_w, unsigned int p_h) const {
+        if (p_layer >= _layers.size() || !clip(p_x, p_y, p_w, p_h))
+            return false;
+
+        const unsigned int w0 = p_x >> 6, w1 = (p_x + p_w - 1) >> 6;
+        const uint64_t first = ~(uint64_t)0 << (p_x & 63);
+        const uint64_t last = ~(uint64_t)0 >> (63 - ((p_x + p_w - 1) & 63));
+        for (unsigned int y = p_y; y < p_y + p_h; y++) {
+            const uint64_t* row = &_bits[p_layer][(size_t)y * _stride];
+            if (w0 == w1) {
+                if (row[w0] & first & last)
+                    return true;
+                continue;
+            }
+            if ((row[w0] & first) || (row[w1] & last))
+                return true;
+            for (unsigned int w = w0 + 1; w < w1; w++)
+                if (row[w])
+                    return true;
+        }
+        return false;
+    }
+
+    size_t occupancy::count(unsigned int p_layer, int p_x, int p_y,
+                            unsigned int p_w, unsigned int p_h) const {
+        if (p_layer >= _layers.size() || !clip(p_x, p_y, p_w, p_h))
+            return 0;
+
+        const unsigned int w0 = p_x >> 6, w1 = (p_x + p_w - 1) >> 6;
+        const uint64_t first = ~(uint64_t)0 << (p_x & 63);
+        const uint64_t last = ~(uint64_t)0 >> (63 - ((p_x + p_w - 1) & 63));
+        size_t n = 0;
+        for (unsigned int y = p_y; y < p_y + p_h; y++) {
+            const uint64_t* row = &_bits[p_layer][(size_t)y * _stride];
+            if (w0 == w1) {
+                n += __builtin_popcountll(row[w0] & first & last);
+                continue;
+            }
+            n += __builtin_popcountll(row[w0] & first);
+            n += __builtin_popcountll(row[w1] & last);
+            for (unsigned int w = w0 + 1; w < w1; w++)
+                n += __builtin_popcountll(row[w]);
+        }
+        return n;
+    }
+
+    bool occupancy::anyVisible(int p_x, int p_y,
+                               unsigned int p_w, unsigned int p_h) const {
+        for (uint64_t m = _visible; m; m &= m - 1)
+            if (any(__builtin_ctzll(m), p_x, p_y, p_w, p_h))
+                return true;
+        return false;
+    }
+
+    unsigned int occupancy::update(unsigned int p_threads) {
+        const unsigned int cols = (_width + TMX_CHUNK_SIZE - 1) /
+                                  TMX_CHUNK_SIZE;
+        const unsigned int rows = (_height + TMX_CHUNK_SIZE - 1) /
+                                  TMX_CHUNK_SIZE;
+
+        // Flag the stale layer chunks, (row, layer, column) major.
+        std::vector<char> stale((size_t)rows * _layers.size() * cols, 0);
+        std::vector<unsigned int> dirty;
+        unsigned int n = 0;
+        for (unsigned int cy = 0; cy < rows; cy++) {
+            bool any = false;
+            for (unsigned int l = 0; l < _layers.size(); l++) {
+                const tilelayer* t = _layers[l];
+                for (unsigned int cx = 0; cx < cols; cx++) {
+                    if (cx >= t->chunksX() || cy >= t->chunksY())
+                        continue;
+                    uint32_t& rev = _revs[l][cy * t->chunksX() + cx];
+                    if (rev == t->revision(cx, cy))
+                        continue;
+                    rev = t->revision(cx, cy);
+                    stale[((size_t)cy * _layers.size() + l) * cols + cx] = 1;
+                    any = true;
+                    n++;
+                }
+            }
+            if (any)
+                dirty.push_back(cy);
+        }
+
+        // Chunk rows share no bitmap words nor masks, build them in parallel.
+        parallelFor(dirty.size(), [&](size_t i) {
+            buildRow(dirty[i], stale);
+        }, p_threads);
+        return n;
+    }
+
+    bool occupancy::occupies(uint32_t p_gid) const {
+        p_gid &= TMX_GID_MASK;
+        if (p_gid == 0)
+            return false;
+        if (_gids.empty())
+            return true;
+        return (p_gid >> 6) < _gids.size() &&
+               ((_gids[p_gid >> 6] >> (p_gid & 63)) & 1);
+    }
+
+    void occupancy::buildRow(unsigned int p_cy,
+                             const std::vector<char>& p_stale) {
+        const unsigned int cols = (_width + TMX_CHUNK_SIZE - 1) /
+                                  TMX_CHUNK_SIZE;
+        const unsigned int y0 = p_cy * TMX_CHUNK_SIZE;
+        const unsigned int h = std::min<unsigned int>(TMX_CHUNK_SIZE,
+                                                      _height - y0);
+        std::vector<uint32_t> gids(TMX_CHUNK_SIZE * TMX_CHUNK_SIZE);
+
+        for (unsigned int l = 0; l < _layers.size(); l++)
+            for (unsigned int cx = 0; cx < cols; cx++) {
+                if (!p_stale[((size_t)p_cy * _layers.size() + l) * cols + cx])
+                    continue;
+
+                const unsigned int x0 = cx * TMX_CHUNK_SIZE;
+                const unsigned int w = std::min<unsigned int>(TMX_CHUNK_SIZE,
+                                                              _width - x0);
+                _layers[l]->read(x0, y0, w, h, gids.data());
+
+                const unsigned int byte = l >> 3;
+                const uint8_t bit = 1 << (l & 7);
+                for (unsigned int y = 0; y < h; y++) {
+                    uint64_t* row = &_bits[l][(size_t)(y0 + y) * _stride];
+                    uint8_t* m = &_masks[((size_t)(y0 + y) * _width + x0) *
+                                         _bytes + byte];
+
+                    // Gather the row's bits, then write each word once.
+                    uint64_t word = 0, keep = ~(uint64_t)0;
+                    unsigned int wi = x0 >> 6;
+                    for (unsigned int x = 0; x < w; x++, m += _bytes) {
+                        const unsigned int c = x0 + x;
+                        if ((c >> 6) != wi) {
+                            row[wi] = (row[wi] & keep) | word;
+                            wi = c >> 6;
+                            word = 0;
+                            keep = ~(uint64_t)0;
+                        }
+
+                        const bool on = occupies(gids[y * w + x]);
+                        keep &= ~((uint64_t)1 << (c & 63));
+                        word |= (uint64_t)on << (c & 63);
+                        *m = on ? (*m | bit) : (*m & ~bit);
+                    }
+                    row[wi] = (row[wi] & keep) | word;
+                }
+            }
+    }
+
+    bool occupancy::clip(int& p_x, int& p_y,
+                         unsigned int& p_w, unsigned int& p_h) const {
+        long x0 = std::max(0L, (long)p_x), y0 = std::max(0L, (long)p_y);
+        long x1 = std::min((long)_width, (long)p_x + (long)p_w);
+        long y1 = std::min((long)_height, (long)p_y + (long)p_h);
+        if (x0 >= x1 || y0 >= y1)
+            return false;
+        p_x = x0;
+        p_y = y0;
+        p_w = x1 - x0;
+        p_h = y1 - y0;
+        return true;
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef LM_TMX_OCCUPANCY_H
+#define LM_TMX_OCCUPANCY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Occupancy bitmaps of a map's tile layers. Each layer gets one bit per
+ * cell, and each cell gets a composite mask with one bit per layer, so
+ * "topmost visible tile at (x, y)" is a single bit scan and rectangle
+ * queries run 64 cells at a time.
+ *
+ * Layers are numbered in document order, bottom to top.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_OCC_MAX_LAYERS 64 //@- Layers past this many are ignored.
+
+namespace tmx {
+    class occupancy {
+    public:
+        occupancy();
+
+        /**
+         * Builds the bitmaps of a map's tile layers. Layers that are hidden
+         * or fully transparent are left out of the visible composite.
+         *
+         * @param p_map The root <map> node.
+         * @param p_gids Gids that count as occupied, as a bitset indexed...
+         * ...by gid. (ie. proptable::bits) Defaults to any non-empty tile.
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         */
+        occupancy(
+            sNode& p_map,
+            const std::vector<uint64_t>* p_gids = nullptr,
+            unsigned int p_threads = 0
+        );
+
+        /** @returns [unsigned int] Width of the map in tiles. */
+        unsigned int width() const;
+        /** @returns [unsigned int] Height of the map in tiles. */
+        unsigned int height() const;
+        /** @returns [unsigned int] Number of layers covered. */
+        unsigned int layers() const;
+
+        /**
+         * @param p_layer Index of the layer.
+         * @returns [const tilelayer*] Tiles of the layer.
+         */
+        const tilelayer* layer(unsigned int p_layer) const;
+
+        /**
+         * Includes or leaves out a layer of the visible composite.
+         *
+         * @param p_layer Index of the layer.
+         * @param p_visible Whether the layer is shown.
+         */
+        void setVisible(unsigned int p_layer, bool p_visible);
+
+        /** @returns [uint64_t] Bits of the layers in the visible composite. */
+        uint64_t visible() const;
+
+        /**
+         * @param p_layer Index of the layer.
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [bool] Whether the layer's cell is occupied.
+         */
+        bool occupied(unsigned int p_layer, int p_x, int p_y) const;
+
+        /**
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [uint64_t] Bit l set for each layer l occupying the cell.
+         */
+        uint64_t mask(int p_x, int p_y) const;
+
+        /**
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [int] Topmost visible layer occupying the cell, -1 if none.
+         */
+        int topmost(int p_x, int p_y) const;
+
+        /**
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [uint32_t] Gid of the topmost visible tile, 0 if none.
+         */
+        uint32_t topmostGid(int p_x, int p_y) const;
+
+        /**
+         * Tests a rectangle of a layer for occupied cells, a word at a time.
+         * The rectangle is clipped to the map.
+         *
+         * @param p_layer Index of the layer.
+         * @param p_x Left column of the rectangle.
+         * @param p_y Top row of the rectangle.
+         * @param p_w Width of the rectangle.
+         * @param p_h Height of the rectangle.
+         * @returns [bool] Whether any cell of the rectangle is occupied.
+         */
+        bool any(unsigned int p_layer, int p_x, int p_y,
+                 unsigned int p_w, unsigned int p_h) const;
+
+        /** @returns [size_t] Number of occupied cells in the rectangle. */
+        size_t count(unsigned int p_layer, int p_x, int p_y,
+                     unsigned int p_w, unsigned int p_h) const;
+
+        /**
+         * @returns [bool] Whether any visible layer occupies a cell of the...
+         * ...rectangle.
+         */
+        bool anyVisible(int p_x, int p_y,
+                        unsigned int p_w, unsigned int p_h) const;
+
+        /**
+         * Rebuilds the bitmaps of the layer chunks that changed since the
+         * last update.
+         *
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         * @returns [unsigned int] Number of layer chunks rebuilt.
+         */
+        unsigned int update(unsigned int p_threads = 0);
+    private:
+        bool occupies(uint32_t p_gid) const;
+        void buildRow(unsigned int p_cy, const std::vector<char>& p_stale);
+        bool clip(int& p_x, int& p_y,
+                  unsigned int& p_w, unsigned int& p_h) const;
+
+        unsigned int _width;
+        unsigned int _height;
+        unsigned int _stride; //@- Words per bitmap row.
+        unsigned int _bytes; //@- Bytes per composite mask.
+        uint64_t _visible;
+        std::vector<const tilelayer*> _layers;
+        std::vector<uint64_t> _gids; //@- Occupying gids, empty = any.
+        //@- Bitmap of each layer, rows padded to whole words.
+        std::vector<std::vector<uint64_t>> _bits;
+        std::vector<uint8_t> _masks; //@- Composite mask of each cell.
+        //@- Chunk revisions each layer's bitmap was built from.
+        std::vector<std::vector<uint32_t>> _revs;
+    };
+}
+
+#endif
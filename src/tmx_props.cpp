@@ -0,0 +1,192 @@
+#include "tmx_props.h"
+#include "tmx_tileset.h"
+
+/**
+ * Test a bit of a bitset.
+ *
+ * @param p_bits The bitset.
+ * @param p_i Index of the bit.
+ * @returns [bool] Whether or not the bit is set.
+ */
+static inline bool testBit(const std::vector<uint64_t>& p_bits, uint32_t p_i) {
+    return (p_bits[p_i >> 6] >> (p_i & 63)) & 1;
+}
+
+namespace tmx {
+    proptable::proptable() {
+        _gids = 0;
+    }
+
+    proptable::proptable(sNode& p_map) {
+        std::vector<sTileset> sets = loadTilesets(p_map);
+        _gids = maxGid(sets) + 1;
+        const size_t words = (_gids + 63) / 64;
+
+        for (unsigned int s = 0; s < sets.size(); s++)
+            for (auto it = sets[s].node->nodes; it; it = it->next()) {
+                sNode& tile = *it->valptr();
+                if (tile.tag != eTag::tile)
+                    continue;
+
+                const long id = valInt(getNodeVar(tile, "id"), -1);
+                if (id < 0 || (uint32_t)id >= sets[s].count)
+                    continue;
+                const uint32_t gid = sets[s].firstgid + id;
+
+                // Properties are the variables named with the ' prefix.
+                for (auto v = tile.vars; v; v = v->next()) {
+                    const sNamedVal& var = *v->valptr();
+                    if (var.name.empty() || var.name[0] != '\'')
+                        continue;
+
+                    const std::string name = var.name.str().substr(1);
+                    auto k = _keys.find(name);
+                    if (k == _keys.end()) {
+                        k = _keys.insert({name, (uint32_t)_cols.size()}).first;
+                        _cols.push_back(sColumn());
+                        sColumn& c = _cols.back();
+                        c.name = name;
+                        c.type = var.myvalue.type;
+                        c.present.assign(words, 0);
+                        switch (c.type) {
+                        case eType::whole: c.ints.assign(_gids, 0); break;
+                        case eType::dec: c.decs.assign(_gids, 0); break;
+                        case eType::boolean: c.bools.assign(words, 0); break;
+                        default:
+                            c.type = eType::str;
+                            c.strs.assign(_gids, TMX_PROP_NONE);
+                            break;
+                        }
+                    }
+
+                    sColumn& c = _cols[k->second];
+                    c.present[gid >> 6] |= (uint64_t)1 << (gid & 63);
+                    switch (c.type) {
+                    case eType::whole:
+                        c.ints[gid] = valInt(var.myvalue);
+                        break;
+                    case eType::dec:
+                        c.decs[gid] = valDec(var.myvalue);
+                        break;
+                    case eType::boolean:
+                        if (var.myvalue.value == "true" ||
+                            var.myvalue.value == "1")
+                            c.bools[gid >> 6] |= (uint64_t)1 << (gid & 63);
+                        break;
+                    default:
+                        c.strs[gid] = intern(var.myvalue.value);
+                        break;
+                    }
+                }
+            }
+    }
+
+    uint32_t proptable::key(str_p p_name) const {
+        auto it = _keys.find(p_name);
+        return (it == _keys.end()) ? TMX_PROP_NONE : it->second;
+    }
+
+    eType proptable::type(uint32_t p_key) const {
+        return (p_key < _cols.size()) ? _cols[p_key].type : eType::error;
+    }
+
+    bool proptable::has(uint32_t p_gid, uint32_t p_key) const {
+        p_gid &= TMX_GID_MASK;
+        if (p_key >= _cols.size() || p_gid >= _gids)
+            return false;
+        return testBit(_cols[p_key].present, p_gid);
+    }
+
+    long proptable::getInt(uint32_t p_gid, uint32_t p_key, long p_default) const {
+        if (!has(p_gid, p_key))
+            return p_default;
+        const sColumn& c = _cols[p_key];
+        p_gid &= TMX_GID_MASK;
+        switch (c.type) {
+        case eType::whole: return c.ints[p_gid];
+        case eType::dec: return (long)c.decs[p_gid];
+        case eType::boolean: return testBit(c.bools, p_gid);
+        default: return strtol(_strings[c.strs[p_gid]].c_str(), nullptr, 10);
+        }
+    }
+
+    float proptable::getDec(uint32_t p_gid, uint32_t p_key, float p_default) const {
+        if (!has(p_gid, p_key))
+            return p_default;
+        const sColumn& c = _cols[p_key];
+        p_gid &= TMX_GID_MASK;
+        switch (c.type) {
+        case eType::whole: return c.ints[p_gid];
+        case eType::dec: return c.decs[p_gid];
+        case eType::boolean: return testBit(c.bools, p_gid);
+        default: return strtof(_strings[c.strs[p_gid]].c_str(), nullptr);
+        }
+    }
+
+    bool proptable::getBool(uint32_t p_gid, uint32_t p_key) const {
+        if (!has(p_gid, p_key))
+            return false;
+        const sColumn& c = _cols[p_key];
+        p_gid &= TMX_GID_MASK;
+        switch (c.type) {
+        case eType::whole: return c.ints[p_gid] != 0;
+        case eType::dec: return c.decs[p_gid] != 0;
+        case eType::boolean: return testBit(c.bools, p_gid);
+        default: return _strings[c.strs[p_gid]] == "true";
+        }
+    }
+
+    uint32_t proptable::getStr(uint32_t p_gid, uint32_t p_key) const {
+        if (!has(p_gid, p_key) || _cols[p_key].type != eType::str)
+            return TMX_PROP_NONE;
+        return _cols[p_key].strs[p_gid & TMX_GID_MASK];
+    }
+
+    str_p proptable::string(uint32_t p_id) const {
+        return _strings.at(p_id);
+    }
+
+    const std::vector<uint64_t>& proptable::bits(uint32_t p_key) const {
+        return _cols.at(p_key).bools;
+    }
+
+    void proptable::filter(
+        const tilelayer& p_tiles,
+        uint32_t p_key,
+        std::vector<uint64_t>& p_out
+    ) const {
+        const size_t n = (size_t)p_tiles.width() * p_tiles.height();
+        p_out.assign((n + 63) / 64, 0);
+        if (p_key >= _cols.size() || _cols[p_key].type != eType::boolean)
+            return;
+
+        const uint64_t* col = _cols[p_key].bools.data();
+        const uint32_t gids = _gids;
+
+        // Decode the layer a row at a time and look each gid up in the
+        // column, building the output 64 cells per word.
+        std::vector<uint32_t> row(p_tiles.width());
+        size_t i = 0;
+        for (unsigned int y = 0; y < p_tiles.height(); y++) {
+            p_tiles.read(0, y, p_tiles.width(), 1, row.data());
+            for (unsigned int x = 0; x < row.size(); x++, i++) {
+                const uint32_t g = row[x] & TMX_GID_MASK;
+                const uint64_t b = (g < gids) ? (col[g >> 6] >> (g & 63)) & 1 : 0;
+                p_out[i >> 6] |= b << (i & 63);
+            }
+        }
+    }
+
+    uint32_t proptable::keys() const {
+        return _cols.size();
+    }
+
+    uint32_t proptable::intern(str_p p_str) {
+        auto it = _stringids.find(p_str);
+        if (it != _stringids.end())
+            return it->second;
+        _strings.push_back(p_str);
+        _stringids[p_str] = _strings.size() - 1;
+        return _strings.size() - 1;
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef LM_TMX_PROPS_H
+#define LM_TMX_PROPS_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Map-wide table of tileset tile properties. Every property name becomes a
+ * key with one typed column indexed by gid, so "does gid X have property Y"
+ * is an array lookup instead of a walk over <tileset> > <tile> nodes.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_PROP_NONE 0xFFFFFFFFu //@- Unknown property key / string id.
+
+namespace tmx {
+    class proptable {
+    public:
+        proptable();
+
+        /**
+         * Builds the table from the <tile> properties of a map's tilesets.
+         * A key's column takes the type of the first value found for it.
+         *
+         * @param p_map The root <map> node.
+         */
+        proptable(sNode& p_map);
+
+        /**
+         * @param p_name Name of the property.
+         * @returns [uint32_t] Key of the property, TMX_PROP_NONE if no...
+         * ...tile has it.
+         */
+        uint32_t key(str_p p_name) const;
+
+        /**
+         * @param p_key Key of the property.
+         * @returns [eType] Type of the property's column.
+         */
+        eType type(uint32_t p_key) const;
+
+        /**
+         * @param p_gid Gid of the tile, flip flags are ignored.
+         * @param p_key Key of the property.
+         * @returns [bool] Whether or not the tile has the property.
+         */
+        bool has(uint32_t p_gid, uint32_t p_key) const;
+
+        /** @returns [long] Property value as an integer, p_default if unset. */
+        long getInt(uint32_t p_gid, uint32_t p_key, long p_default = 0) const;
+        /** @returns [float] Property value as a decimal, p_default if unset. */
+        float getDec(uint32_t p_gid, uint32_t p_key, float p_default = 0) const;
+        /** @returns [bool] Property value as a boolean, false if unset. */
+        bool getBool(uint32_t p_gid, uint32_t p_key) const;
+
+        /**
+         * @returns [uint32_t] String id of a str property's value,...
+         * ...TMX_PROP_NONE if unset.
+         */
+        uint32_t getStr(uint32_t p_gid, uint32_t p_key) const;
+
+        /**
+         * @param p_id String id returned by getStr.
+         * @returns [str_p] The string.
+         */
+        str_p string(uint32_t p_id) const;
+
+        /**
+         * Get the bitset column of a boolean property. Bit (gid & 63) of
+         * word (gid >> 6) is set for each gid whose property is true.
+         *
+         * @param p_key Key of the property.
+         * @returns [const std::vector<uint64_t>&] The column's bits.
+         */
+        const std::vector<uint64_t>& bits(uint32_t p_key) const;
+
+        /**
+         * Filters a layer by a boolean property, 64 cells per output word.
+         *
+         * @param p_tiles Layer to filter.
+         * @param p_key Key of a boolean property.
+         * @param p_out Bits to write to, row-major. Bit (i & 63) of word...
+         * ...(i >> 6) is set if cell i's tile has the property true.
+         */
+        void filter(
+            const tilelayer& p_tiles,
+            uint32_t p_key,
+            std::vector<uint64_t>& p_out
+        ) const;
+
+        /** @returns [uint32_t] Number of property keys. */
+        uint32_t keys() const;
+    private:
+        // Column of one property.
+        struct sColumn {
+            std::string name;
+            eType type;
+            std::vector<uint64_t> present; //@- Whether each gid has a value.
+            std::vector<int32_t> ints; //@- eType::whole values.
+            std::vector<float> decs; //@- eType::dec values.
+            std::vector<uint64_t> bools; //@- eType::boolean values.
+            std::vector<uint32_t> strs; //@- eType::str string ids.
+        };
+
+        uint32_t intern(str_p p_str);
+
+        uint32_t _gids; //@- Number of gids covered. (max gid + 1)
+        std::vector<sColumn> _cols;
+        std::unordered_map<std::string, uint32_t> _keys;
+        std::vector<std::string> _strings;
+        std::unordered_map<std::string, uint32_t> _stringids;
+    };
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include <algorithm>
+
+#include "tmx_pyramid.h"
+#include "tmx_utils.h"
+
+namespace tmx {
+    pyramid::pyramid() {
+        _tiles = nullptr;
+        _sample = eSample::majority;
+    }
+
+    pyramid::pyramid(
+        const tilelayer* p_tiles,
+        eSample p_sample,
+        const std::vector<uint32_t>& p_priority,
+        unsigned int p_levels,
+        unsigned int p_threads
+    ) {
+        _tiles = p_tiles;
+        _sample = p_sample;
+        _priority = p_priority;
+
+        unsigned int w = _tiles->width(), h = _tiles->height();
+        while ((w > 1 || h > 1) &&
+               (p_levels == 0 || _levels.size() + 1 < p_levels)) {
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+            _levels.push_back(sLevel());
+            _levels.back().width = w;
+            _levels.back().height = h;
+            _levels.back().gids.assign((size_t)w * h, 0);
+            _levels.back().cover.assign((size_t)w * h, 0);
+        }
+
+        // Start from revisions no chunk can have so update builds it all.
+        _revs.assign((size_t)_tiles->chunksX() * _tiles->chunksY(),
+                     UINT32_MAX);
+        update(p_threads);
+    }
+
+    unsigned int pyramid::levels() const {
+        return _tiles ? _levels.size() + 1 : 0;
+    }
+
+    unsigned int pyramid::width(unsigned int p_level) const {
+        return (p_level == 0) ? _tiles->width() :
+                                _levels.at(p_level - 1).width;
+    }
+
+    unsigned int pyramid::height(unsigned int p_level) const {
+        return (p_level == 0) ? _tiles->height() :
+                                _levels.at(p_level - 1).height;
+    }
+
+    uint32_t pyramid::gid(unsigned int p_level, unsigned int p_x,
+                          unsigned int p_y) const {
+        uint32_t g;
+        read(p_level, p_x, p_y, 1, 1, &g);
+        return g;
+    }
+
+    uint32_t pyramid::coverage(unsigned int p_level, unsigned int p_x,
+                               unsigned int p_y) const {
+        uint32_t c;
+        readCoverage(p_level, p_x, p_y, 1, 1, &c);
+        return c;
+    }
+
+    void pyramid::read(
+        unsigned int p_level,
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h,
+        uint32_t* p_out
+    ) const {
+        if (p_level == 0) {
+            _tiles->read(p_x, p_y, p_w, p_h, p_out);
+            return;
+        }
+
+        const sLevel& l = _levels.at(p_level - 1);
+        for (unsigned int y = 0; y < p_h; y++)
+            for (unsigned int x = 0; x < p_w; x++) {
+                const size_t cx = (size_t)p_x + x, cy = (size_t)p_y + y;
+                const bool in = cx < l.width && cy < l.height;
+                p_out[y * p_w + x] = in ? l.gids[cy * l.width + cx] : 0;
+            }
+    }
+
+    void pyramid::readCoverage(
+        unsigned int p_level,
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h,
+        uint32_t* p_out
+    ) const {
+        if (p_level == 0) {
+            _tiles->read(p_x, p_y, p_w, p_h, p_out);
+            for (size_t i = 0; i < (size_t)p_w * p_h; i++)
+                p_out[i] = (p_out[i] & TMX_GID_MASK) != 0;
+            return;
+        }
+
+        const sLevel& l = _levels.at(p_level - 1);
+        for (unsigned int y = 0; y < p_h; y++)
+            for (unsigned int x = 0; x < p_w; x++) {
+                const size_t cx = (size_t)p_x + x, cy = (size_t)p_y + y;
+                const bool in = cx < l.width && cy < l.height;
+                p_out[y * p_w + x] = in ? l.cover[cy * l.width + cx] : 0;
+            }
+    }
+
+    unsigned int pyramid::update(unsigned int p_threads) {
+        if (_levels.empty())
+            return 0;
+
+        // Cells of level 1 above the stale layer chunks.
+        sSpans spans;
+        spans.lo.assign(_levels[0].height, INT32_MAX);
+        spans.hi.assign(_levels[0].height, -1);
+        unsigned int n = 0;
+        for (unsigned int cy = 0; cy < _tiles->chunksY(); cy++)
+            for (unsigned int cx = 0; cx < _tiles->chunksX(); cx++) {
+                uint32_t& rev = _revs[cy * _tiles->chunksX() + cx];
+                if (rev == _tiles->revision(cx, cy))
+                    continue;
+                rev = _tiles->revision(cx, cy);
+                n++;
+
+                const unsigned int half = TMX_CHUNK_SIZE / 2;
+                const int x0 = cx * half;
+                const int x1 = std::min<int>((cx + 1) * half - 1,
+                                             _levels[0].width - 1);
+                const unsigned int y1 = std::min<unsigned int>(
+                    (cy + 1) * half - 1, _levels[0].height - 1);
+                for (unsigned int y = cy * half; y <= y1; y++) {
+                    spans.lo[y] = std::min(spans.lo[y], x0);
+                    spans.hi[y] = std::max(spans.hi[y], x1);
+                }
+            }
+
+        // Resample level by level, each row only reads the two rows below.
+        for (unsigned int l = 1; l <= _levels.size(); l++) {
+            std::vector<unsigned int> rows;
+            for (unsigned int y = 0; y < spans.lo.size(); y++)
+                if (spans.lo[y] <= spans.hi[y])
+                    rows.push_back(y);
+            if (rows.empty())
+                break;
+
+            parallelFor(rows.size(), [&](size_t i) {
+                resample(l, rows[i], spans.lo[rows[i]], spans.hi[rows[i]]);
+            }, p_threads);
+
+            if (l == _levels.size())
+                break;
+
+            sSpans up;
+            up.lo.assign(_levels[l].height, INT32_MAX);
+            up.hi.assign(_levels[l].height, -1);
+            for (unsigned int i = 0; i < rows.size(); i++) {
+                const unsigned int y = rows[i];
+                up.lo[y / 2] = std::min(up.lo[y / 2], spans.lo[y] / 2);
+                up.hi[y / 2] = std::max(up.hi[y / 2], spans.hi[y] / 2);
+            }
+            spans = up;
+        }
+        return n;
+    }
+
+    void pyramid::resample(unsigned int p_level, unsigned int p_y,
+                           int p_x0, int p_x1) {
+        // The two rows of cells below, 2 cells per cell resampled.
+        const unsigned int cw = 2 * (p_x1 - p_x0 + 1);
+        std::vector<uint32_t> g(2 * cw), c(2 * cw);
+        if (p_level == 1) {
+            _tiles->read(2 * p_x0, 2 * p_y, cw, 2, g.data());
+            for (unsigned int i = 0; i < g.size(); i++)
+                c[i] = (g[i] & TMX_GID_MASK) != 0;
+        }
+        else {
+            const sLevel& b = _levels[p_level - 2];
+            for (unsigned int r = 0; r < 2; r++)
+                for (unsigned int i = 0; i < cw; i++) {
+                    const unsigned int x = 2 * p_x0 + i, y = 2 * p_y + r;
+                    const bool in = x < b.width && y < b.height;
+                    g[r * cw + i] = in ? b.gids[(size_t)y * b.width + x] : 0;
+                    c[r * cw + i] = in ? b.cover[(size_t)y * b.width + x] : 0;
+                }
+        }
+
+        sLevel& l = _levels[p_level - 1];
+        for (int x = p_x0; x <= p_x1; x++) {
+            const unsigned int i = 2 * (x - p_x0);
+            const uint32_t qg[4] = { g[i], g[i + 1], g[cw + i], g[cw + i + 1] };
+            const uint32_t qc[4] = { c[i], c[i + 1], c[cw + i], c[cw + i + 1] };
+            const size_t at = (size_t)p_y * l.width + x;
+            l.gids[at] = pick(qg, qc);
+            l.cover[at] = qc[0] + qc[1] + qc[2] + qc[3];
+        }
+    }
+
+    uint32_t pyramid::pick(const uint32_t* p_gids,
+                           const uint32_t* p_cover) const {
+        uint32_t best = 0;
+        uint64_t score = 0;
+        for (unsigned int i = 0; i < 4; i++) {
+            const uint32_t id = p_gids[i] & TMX_GID_MASK;
+            if (p_cover[i] == 0 || id == 0)
+                continue;
+
+            // Flipped variants of a tile count as the same tile.
+            uint64_t s;
+            if (_sample == eSample::priority) {
+                s = (id < _priority.size()) ? _priority[id] : 0;
+            }
+            else {
+                s = 0;
+                for (unsigned int j = 0; j < 4; j++)
+                    if ((p_gids[j] & TMX_GID_MASK) == id)
+                        s += p_cover[j];
+            }
+
+            // Ties go to the first cell, so +1 keeps priority 0 above empty.
+            if (best == 0 || s + 1 > score) {
+                best = p_gids[i];
+                score = s + 1;
+            }
+        }
+        return best;
+    }
+}
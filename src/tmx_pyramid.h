@@ -0,0 +1,135 @@
+#ifndef LM_TMX_PYRAMID_H
+#define LM_TMX_PYRAMID_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_layer.h"
+
+/**============================================================================
+ * Downsampled pyramid of a tile layer, for minimaps and zoomed out views.
+ * Level 0 is the layer itself, each level above halves its width & height.
+ * Every cell holds a representative gid of the 2x2 cells below it, and the
+ * number of non-empty layer tiles it covers.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // How a cell's gid is picked from the 2x2 cells below it.
+    enum eSample {
+        majority, //@- Gid covering the most layer tiles.
+        priority //@- Gid of the highest priority, per a gid-indexed table.
+    };
+
+    class pyramid {
+    public:
+        pyramid();
+
+        /**
+         * Builds the pyramid of a layer, in parallel.
+         *
+         * @param p_tiles The layer's tiles.
+         * @param p_sample How the gids of each level are picked.
+         * @param p_priority Priority of each gid, flip flags excluded...
+         * ...(eSample::priority only) Gids past its end have priority 0.
+         * @param p_levels Maximum number of levels, 0 = down to 1x1.
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         */
+        pyramid(
+            const tilelayer* p_tiles,
+            eSample p_sample = eSample::majority,
+            const std::vector<uint32_t>& p_priority = std::vector<uint32_t>(),
+            unsigned int p_levels = 0,
+            unsigned int p_threads = 0
+        );
+
+        /** @returns [unsigned int] Number of levels, level 0 included. */
+        unsigned int levels() const;
+        /** @returns [unsigned int] Width of a level in cells. */
+        unsigned int width(unsigned int p_level) const;
+        /** @returns [unsigned int] Height of a level in cells. */
+        unsigned int height(unsigned int p_level) const;
+
+        /**
+         * @param p_level Level of the cell.
+         * @param p_x Column of the cell.
+         * @param p_y Row of the cell.
+         * @returns [uint32_t] Gid of the cell, 0 outside of the level.
+         */
+        uint32_t gid(unsigned int p_level, unsigned int p_x,
+                     unsigned int p_y) const;
+
+        /**
+         * @returns [uint32_t] Number of non-empty layer tiles the cell...
+         * ...covers, 0 outside of the level.
+         */
+        uint32_t coverage(unsigned int p_level, unsigned int p_x,
+                          unsigned int p_y) const;
+
+        /**
+         * Copy a rectangle of a level's gids into a row-major array, like
+         * tilelayer::read. Cells outside of the level are read as 0.
+         *
+         * @param p_level Level to read.
+         * @param p_x Left column of the rectangle.
+         * @param p_y Top row of the rectangle.
+         * @param p_w Width of the rectangle.
+         * @param p_h Height of the rectangle.
+         * @param p_out Array of at least p_w * p_h gids to write to.
+         */
+        void read(
+            unsigned int p_level,
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h,
+            uint32_t* p_out
+        ) const;
+
+        /** Same as read, for the coverage counts. */
+        void readCoverage(
+            unsigned int p_level,
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h,
+            uint32_t* p_out
+        ) const;
+
+        /**
+         * Resamples the cells above the layer chunks that changed since the
+         * last update, level by level.
+         *
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         * @returns [unsigned int] Number of layer chunks that had changed.
+         */
+        unsigned int update(unsigned int p_threads = 0);
+    private:
+        // Level above the layer.
+        struct sLevel {
+            unsigned int width;
+            unsigned int height;
+            std::vector<uint32_t> gids;
+            std::vector<uint32_t> cover;
+        };
+
+        // Dirty columns of each row of a level. (lo > hi = clean)
+        struct sSpans { std::vector<int> lo; std::vector<int> hi; };
+
+        void resample(unsigned int p_level, unsigned int p_y,
+                      int p_x0, int p_x1);
+        uint32_t pick(const uint32_t* p_gids, const uint32_t* p_cover) const;
+
+        const tilelayer* _tiles;
+        eSample _sample;
+        std::vector<uint32_t> _priority;
+        std::vector<sLevel> _levels; //@- Levels 1 and up.
+        std::vector<uint32_t> _revs; //@- Layer chunk revisions sampled.
+    };
+}
+
+#endif
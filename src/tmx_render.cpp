@@ -0,0 +1,195 @@
+#include <algorithm>
+
+#include "tmx_render.h"
+#include "tmx_utils.h"
+
+namespace tmx {
+    renderlayer::renderlayer() {
+        _layer = nullptr;
+        _order = eRO::rd;
+        _grouped = true;
+        _opacity = 1;
+        _offsetx = 0;
+        _offsety = 0;
+    }
+
+    renderlayer::renderlayer(sNode& p_map, sNode& p_layer) {
+        _layer = nullptr;
+        _geom = mapGeom(p_map);
+        _sets = loadTilesets(p_map);
+        _opacity = valDec(getNodeVar(p_layer, "opacity"), 1);
+        _offsetx = valDec(getNodeVar(p_layer, "offsetx"));
+        _offsety = valDec(getNodeVar(p_layer, "offsety"));
+
+        const std::string order = getNodeVar(p_map, "renderorder").value;
+        _order = eRO::rd;
+        if (order == "right-up")
+            _order = eRO::ru;
+        else if (order == "left-down")
+            _order = eRO::ld;
+        else if (order == "left-up")
+            _order = eRO::lu;
+
+        // Only orthogonal tiles within their cell never overlap.
+        _grouped = (_geom.orient == eOrient::ortho);
+        for (unsigned int i = 0; i < _sets.size(); i++) {
+            const sTileset& ts = _sets.at(i);
+            if (ts.tilewidth > _geom.tilewidth ||
+                ts.tileheight > _geom.tileheight ||
+                ts.offsetx != 0 || ts.offsety != 0)
+                _grouped = false;
+        }
+
+        // Layers hold their tiles in their <data> child node.
+        for (auto it = p_layer.nodes; it; it = it->next())
+            if (it->valptr()->tag == eTag::data && it->valptr()->data)
+                _layer = it->valptr()->data->tiles;
+
+        if (_layer != nullptr) {
+            _chunks.resize((size_t)_layer->chunksX() * _layer->chunksY());
+            for (unsigned int i = 0; i < _chunks.size(); i++) {
+                _chunks.at(i).rev = 0;
+                _chunks.at(i).built = false;
+            }
+        }
+    }
+
+    unsigned int renderlayer::update(unsigned int p_threads) {
+        // Find the chunks whose tiles changed.
+        std::vector<unsigned int> stale;
+        for (unsigned int cy = 0; cy < chunksY(); cy++)
+            for (unsigned int cx = 0; cx < chunksX(); cx++) {
+                sChunk& c = _chunks[cy * chunksX() + cx];
+                if (!c.built || c.rev != _layer->revision(cx, cy)) {
+                    c.rev = _layer->revision(cx, cy);
+                    stale.push_back(cy * chunksX() + cx);
+                }
+            }
+
+        parallelFor(stale.size(), [&](size_t i) {
+            const unsigned int c = stale.at(i);
+            build(c % chunksX(), c / chunksX(), _chunks[c]);
+        }, p_threads);
+
+        return stale.size();
+    }
+
+    void renderlayer::setOpacity(float p_opacity) {
+        _opacity = p_opacity;
+        for (unsigned int i = 0; i < _chunks.size(); i++)
+            _chunks.at(i).built = false;
+    }
+
+    unsigned int renderlayer::chunksX() const {
+        return (_layer != nullptr) ? _layer->chunksX() : 0;
+    }
+
+    unsigned int renderlayer::chunksY() const {
+        return (_layer != nullptr) ? _layer->chunksY() : 0;
+    }
+
+    const std::vector<sBatch>& renderlayer::batches(
+        unsigned int p_cx,
+        unsigned int p_cy
+    ) const {
+        return _chunks.at(p_cy * chunksX() + p_cx).batches;
+    }
+
+    const std::vector<sTileset>& renderlayer::tilesets() const {
+        return _sets;
+    }
+
+    void renderlayer::build(
+        unsigned int p_cx,
+        unsigned int p_cy,
+        sChunk& p_chunk
+    ) const {
+        const unsigned int x0 = p_cx * TMX_CHUNK_SIZE;
+        const unsigned int y0 = p_cy * TMX_CHUNK_SIZE;
+        const unsigned int w =
+            std::min<unsigned int>(TMX_CHUNK_SIZE, _layer->width() - x0);
+        const unsigned int h =
+            std::min<unsigned int>(TMX_CHUNK_SIZE, _layer->height() - y0);
+
+        std::vector<uint32_t> gids((size_t)w * h);
+        _layer->read(x0, y0, w, h, gids.data());
+
+        p_chunk.batches.clear();
+        // Batch of each tileset within this chunk. (-1 = none yet)
+        std::vector<int> slot(_sets.size(), -1);
+        const bool up = (_order == eRO::ru || _order == eRO::lu);
+        const bool left = (_order == eRO::ld || _order == eRO::lu);
+
+        for (unsigned int iy = 0; iy < h; iy++)
+            for (unsigned int ix = 0; ix < w; ix++) {
+                const unsigned int y = up ? h - 1 - iy : iy;
+                const unsigned int x = left ? w - 1 - ix : ix;
+                const uint32_t gid = gids[y * w + x];
+                const sTileset* ts = findTileset(_sets, gid);
+                if (ts == nullptr)
+                    continue;
+
+                // Overlapping quads start a new batch on each tileset
+                // change, to keep their order.
+                const unsigned int s = ts - _sets.data();
+                if (!_grouped && (p_chunk.batches.empty() ||
+                                  p_chunk.batches.back().tileset != s))
+                    slot[s] = -1;
+                if (slot[s] < 0) {
+                    slot[s] = p_chunk.batches.size();
+                    p_chunk.batches.push_back(sBatch());
+                    p_chunk.batches.back().tileset = s;
+                }
+                sBatch& b = p_chunk.batches[slot[s]];
+
+                // Tiles are drawn bottom-aligned to their cell.
+                float px, py;
+                tileToPixel(_geom, x0 + x, y0 + y, px, py);
+                px += _offsetx + ts->offsetx;
+                const float qw = ts->tilewidth, qh = ts->tileheight;
+                py += _offsety + ts->offsety + _geom.tileheight - qh;
+
+                // Texture coordinates of the tile's corners. (TL, TR, BR, BL)
+                float u[4] = { 0, 1, 1, 0 }, v[4] = { 0, 0, 1, 1 };
+                if (ts->imagewidth > 0 && ts->columns > 0) {
+                    const uint32_t id = (gid & TMX_GID_MASK) - ts->firstgid;
+                    const float sx = ts->margin +
+                                     (id % ts->columns) * (qw + ts->spacing);
+                    const float sy = ts->margin +
+                                     (id / ts->columns) * (qh + ts->spacing);
+                    u[0] = u[3] = sx / ts->imagewidth;
+                    u[1] = u[2] = (sx + qw) / ts->imagewidth;
+                    v[0] = v[1] = sy / ts->imageheight;
+                    v[2] = v[3] = (sy + qh) / ts->imageheight;
+                }
+
+                // Flip the corners' texture coordinates, diagonal first.
+                if (gid & TMX_FLIP_D) {
+                    std::swap(u[1], u[3]);
+                    std::swap(v[1], v[3]);
+                }
+                if (gid & TMX_FLIP_H) {
+                    std::swap(u[0], u[1]); std::swap(v[0], v[1]);
+                    std::swap(u[3], u[2]); std::swap(v[3], v[2]);
+                }
+                if (gid & TMX_FLIP_V) {
+                    std::swap(u[0], u[3]); std::swap(v[0], v[3]);
+                    std::swap(u[1], u[2]); std::swap(v[1], v[2]);
+                }
+
+                const float cx[4] = { px, px + qw, px + qw, px };
+                const float cy[4] = { py, py, py + qh, py + qh };
+                const uint32_t first = b.vertices.size();
+                for (unsigned int i = 0; i < 4; i++)
+                    b.vertices.push_back({
+                        cx[i], cy[i], u[i], v[i], _opacity, gid & ~TMX_GID_MASK
+                    });
+
+                const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+                for (unsigned int i = 0; i < 6; i++)
+                    b.indices.push_back(first + quad[i]);
+            }
+
+        p_chunk.built = true;
+    }
+}
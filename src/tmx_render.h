@@ -0,0 +1,114 @@
+#ifndef LM_TMX_RENDER_H
+#define LM_TMX_RENDER_H
+
+#include <vector>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+#include "tmx_coords.h"
+#include "tmx_tileset.h"
+
+/**============================================================================
+ * CPU-side render batches for tile layers. Each TMX_CHUNK_SIZE chunk of a
+ * layer is turned into indexed quads, ready to upload, and only rebuilt when
+ * its tiles change.
+ *
+ * Quads that can't overlap, (orthogonal maps whose tiles all fit in their
+ * cell) are grouped by tileset, one batch each. Otherwise they keep the
+ * map's renderorder and a new batch starts whenever the tileset changes,
+ * so drawing the batches in order keeps the painter's order. Chunks should
+ * then be drawn in renderorder too, as tall tiles reach into their
+ * neighbours.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Vertex structure.
+    struct sVertex {
+        float x; //@- Pixel position.
+        float y;
+        float u; //@- Texture coordinates, flips already applied.
+        float v;
+        float opacity;
+        uint32_t flags; //@- Flip flags of the tile. (TMX_FLIP_*)
+    };
+
+    // Quads of one tileset.
+    struct sBatch {
+        unsigned int tileset; //@- Index into renderlayer::tilesets().
+        std::vector<sVertex> vertices; //@- 4 per tile. (TL, TR, BR, BL)
+        std::vector<uint32_t> indices; //@- 6 per tile.
+    };
+
+    class renderlayer {
+    public:
+        renderlayer();
+
+        /**
+         * Sets up batch generation for a layer. Call update() to generate
+         * the batches.
+         *
+         * @param p_map The root <map> node the layer belongs to.
+         * @param p_layer The <layer> node to generate batches for.
+         */
+        renderlayer(sNode& p_map, sNode& p_layer);
+
+        /**
+         * Regenerates the batches of the chunks whose tiles changed since
+         * they were last generated, in parallel.
+         *
+         * @param p_threads Maximum number of threads, defaults to one per...
+         * ...core.
+         * @returns [unsigned int] Number of chunks regenerated.
+         */
+        unsigned int update(unsigned int p_threads = 0);
+
+        /**
+         * Changes the layer's opacity, all chunks are regenerated on the
+         * next update.
+         *
+         * @param p_opacity Opacity from 0 to 1.
+         */
+        void setOpacity(float p_opacity);
+
+        /** @returns [unsigned int] Number of chunk columns. */
+        unsigned int chunksX() const;
+        /** @returns [unsigned int] Number of chunk rows. */
+        unsigned int chunksY() const;
+
+        /**
+         * Get the batches of a chunk, to draw in order. Tiles are emitted
+         * in the map's renderorder.
+         *
+         * @param p_cx Chunk column.
+         * @param p_cy Chunk row.
+         * @returns [const std::vector<sBatch>&] The chunk's batches.
+         */
+        const std::vector<sBatch>& batches(
+            unsigned int p_cx,
+            unsigned int p_cy
+        ) const;
+
+        /** @returns [const std::vector<sTileset>&] The map's tilesets. */
+        const std::vector<sTileset>& tilesets() const;
+    private:
+        // Generated chunk.
+        struct sChunk { std::vector<sBatch> batches; uint32_t rev; bool built; };
+
+        void build(unsigned int p_cx, unsigned int p_cy, sChunk& p_chunk) const;
+
+        const tilelayer* _layer; //@- Layer to generate batches for.
+        sMapGeom _geom; //@- Geometry of the layer's map.
+        eRO _order; //@- Render order of the map's tiles.
+        bool _grouped; //@- Quads can't overlap, batch them by tileset.
+        std::vector<sTileset> _sets; //@- Tilesets of the layer's map.
+        float _opacity; //@- Layer opacity.
+        float _offsetx; //@- Layer pixel offset.
+        float _offsety;
+        std::vector<sChunk> _chunks;
+    };
+}
+
+#endif
@@ -0,0 +1,224 @@
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include "tmx_snapshot.h"
+
+/**
+ * Wraps a node so that it is freed once its last reference goes away.
+ *
+ * @param p_node Node to take ownership of.
+ * @returns [std::shared_ptr<sNode>] Owning pointer to a heap copy.
+ */
+static std::shared_ptr<tmx::sNode> share(const tmx::sNode& p_node) {
+    return std::shared_ptr<tmx::sNode>(
+        new tmx::sNode(p_node),
+        [](tmx::sNode* p) { tmx::freeNode(*p); delete p; }
+    );
+}
+
+namespace tmx {
+    snapshot::snapshot() {
+        _root = share(mkNode(eTag::ignore));
+        _version = 0;
+    }
+
+    snapshot::snapshot(sNode& p_map) {
+        // Detach the top-level children from the map's list, each becomes
+        // its own subtree.
+        for (auto it = p_map.nodes; it;) {
+            auto next = it->next();
+            _children.push_back(share(*it->valptr()));
+            delete it;
+            it = next;
+        }
+        p_map.nodes = nullptr;
+
+        _root = share(p_map);
+        _version = 0;
+        p_map.vars = nullptr;
+        p_map.data = nullptr;
+    }
+
+    const sNode& snapshot::root() const {
+        return *_root;
+    }
+
+    size_t snapshot::size() const {
+        return _children.size();
+    }
+
+    const sNode& snapshot::child(size_t p_i) const {
+        return *_children.at(p_i);
+    }
+
+    sVal snapshot::attr(str_p p_name, bool p_prop) const {
+        return getNodeVar(*_root, p_name, p_prop);
+    }
+
+    uint64_t snapshot::version() const {
+        return _version;
+    }
+
+    mapbuilder::mapbuilder(const snapshot& p_base) {
+        _snap = p_base;
+        _snap._version++;
+        _rootowned = false;
+        _owned.assign(_snap._children.size(), false);
+    }
+
+    sNode& mapbuilder::root() {
+        if (!_rootowned) {
+            _snap._root = share(cloneNode(*_snap._root));
+            _rootowned = true;
+        }
+        return const_cast<sNode&>(*_snap._root);
+    }
+
+    size_t mapbuilder::size() const {
+        return _snap._children.size();
+    }
+
+    sNode& mapbuilder::edit(size_t p_i) {
+        if (!_owned.at(p_i)) {
+            _snap._children[p_i] = share(cloneNode(*_snap._children[p_i]));
+            _owned[p_i] = true;
+        }
+        return const_cast<sNode&>(*_snap._children[p_i]);
+    }
+
+    sNode& mapbuilder::add(sNode& p_node) {
+        _snap._children.push_back(share(p_node));
+        _owned.push_back(true);
+        p_node.vars = nullptr;
+        p_node.nodes = nullptr;
+        p_node.data = nullptr;
+        return const_cast<sNode&>(*_snap._children.back());
+    }
+
+    void mapbuilder::remove(size_t p_i) {
+        _snap._children.erase(_snap._children.begin() + p_i);
+        _owned.erase(_owned.begin() + p_i);
+    }
+
+    snapshot mapbuilder::build() const {
+        return _snap;
+    }
+
+    readguard::readguard(const mapstore& p_store) : _store(p_store) {
+        _slot = _store.pin();
+        _snap = _store._current.load();
+    }
+
+    readguard::~readguard() {
+        _store.unpin(_slot);
+    }
+
+    const snapshot& readguard::get() const {
+        return *_snap;
+    }
+
+    mapstore::sSlots::sSlots() {
+        for (unsigned int i = 0; i < TMX_SNAPSHOT_READERS; i++) {
+            slots[i].used.store(false, std::memory_order_relaxed);
+            slots[i].epoch.store(UINT64_MAX, std::memory_order_relaxed);
+        }
+        next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    mapstore::mapstore(const snapshot& p_snap) {
+        _slots = new sSlots();
+        _epoch = 0;
+        _current = new snapshot(p_snap);
+    }
+
+    mapstore::~mapstore() {
+        for (unsigned int i = 0; i < _retired.size(); i++)
+            delete _retired.at(i).snap;
+        delete _current.load();
+        for (sSlots* b = _slots; b;) {
+            sSlots* next = b->next.load();
+            delete b;
+            b = next;
+        }
+    }
+
+    void mapstore::publish(const snapshot& p_snap) {
+        std::lock_guard<std::mutex> guard(_writer);
+        const snapshot* old = _current.exchange(new snapshot(p_snap));
+
+        // Readers pinned at the new epoch or later loaded the new snapshot.
+        _retired.push_back({old, ++_epoch});
+        collect();
+    }
+
+    snapshot mapstore::current() const {
+        readguard guard(*this);
+        return *guard;
+    }
+
+    size_t mapstore::reclaim() {
+        std::lock_guard<std::mutex> guard(_writer);
+        return collect();
+    }
+
+    mapstore::sSlot* mapstore::pin() const {
+        // Start probing from a slot picked by thread, so that threads
+        // pinning repeatedly tend to reuse their own slot.
+        const size_t hint = std::hash<std::thread::id>()(
+                                std::this_thread::get_id());
+
+        for (sSlots* b = _slots;;) {
+            for (unsigned int i = 0; i < TMX_SNAPSHOT_READERS; i++) {
+                sSlot& slot = b->slots[(hint + i) % TMX_SNAPSHOT_READERS];
+                bool expected = false;
+                if (slot.used.load(std::memory_order_relaxed) ||
+                    !slot.used.compare_exchange_strong(expected, true))
+                    continue;
+
+                // The epoch must be visible before the snapshot is loaded,
+                // both are sequentially consistent for that reason.
+                slot.epoch.store(_epoch.load());
+                return &slot;
+            }
+
+            // Every slot of the block is taken, move on to the next block,
+            // chaining a new one if there is none. Only one racing reader
+            // gets to chain its block.
+            sSlots* next = b->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                sSlots* grown = new sSlots();
+                if (b->next.compare_exchange_strong(next, grown))
+                    next = grown;
+                else
+                    delete grown;
+            }
+            b = next;
+        }
+    }
+
+    void mapstore::unpin(sSlot* p_slot) const {
+        p_slot->epoch.store(UINT64_MAX);
+        p_slot->used.store(false, std::memory_order_release);
+    }
+
+    size_t mapstore::collect() {
+        uint64_t oldest = UINT64_MAX;
+        for (const sSlots* b = _slots; b; b = b->next.load())
+            for (unsigned int i = 0; i < TMX_SNAPSHOT_READERS; i++)
+                oldest = std::min(oldest, b->slots[i].epoch.load());
+
+        // A snapshot retired at epoch e can only be held by readers pinned
+        // before e.
+        for (unsigned int i = 0; i < _retired.size();) {
+            if (_retired.at(i).epoch > oldest) {
+                i++;
+                continue;
+            }
+            delete _retired.at(i).snap;
+            _retired.at(i) = _retired.back();
+            _retired.pop_back();
+        }
+        return _retired.size();
+    }
+}
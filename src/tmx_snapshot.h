@@ -0,0 +1,211 @@
+#ifndef LM_TMX_SNAPSHOT_H
+#define LM_TMX_SNAPSHOT_H
+
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Immutable map snapshots for concurrent readers. A snapshot owns a map's
+ * top-level child nodes through reference counted subtrees, so versions
+ * built from one another share everything they did not edit.
+ *
+ * Snapshots are published through a mapstore. Readers pin the current one
+ * with a readguard without taking any lock, and a replaced snapshot is only
+ * deleted once no reader pinned before its replacement is left. (epoch based
+ * reclamation)
+ *
+ * There is no limit on the number of readers pinned at once, one thread
+ * included: reader slots come in blocks of TMX_SNAPSHOT_READERS and the
+ * store chains another block, without locking, whenever all of its slots
+ * are taken. Blocks are only released along with the store.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_SNAPSHOT_READERS 64 //@- Reader slots per slot block.
+
+namespace tmx {
+    class snapshot {
+    public:
+        snapshot();
+
+        /**
+         * Takes ownership of a loaded map. The map's memory now belongs to
+         * the snapshot and the node is left undefined.
+         *
+         * @param p_map The root <map> node.
+         */
+        snapshot(sNode& p_map);
+
+        /** @returns [const sNode&] The <map> node, without child nodes. */
+        const sNode& root() const;
+
+        /** @returns [size_t] Number of top-level child nodes. */
+        size_t size() const;
+
+        /**
+         * @param p_i Index of the top-level child node.
+         * @returns [const sNode&] The child node.
+         */
+        const sNode& child(size_t p_i) const;
+
+        /**
+         * Get the <map>'s value for the given attribute or property.
+         *
+         * @param p_name Name of the attribute or property.
+         * @param p_prop Whether or not to look for a property.
+         * @returns [sVal] The value.
+         */
+        sVal attr(str_p p_name, bool p_prop = false) const;
+
+        /** @returns [uint64_t] Number of edits this snapshot went through. */
+        uint64_t version() const;
+    private:
+        friend class mapbuilder;
+
+        std::shared_ptr<const sNode> _root;
+        std::vector<std::shared_ptr<const sNode>> _children;
+        uint64_t _version;
+    };
+
+    // Copy-on-write editor producing a new snapshot from an existing one.
+    class mapbuilder {
+    public:
+        /** @param p_base Snapshot to start from. */
+        mapbuilder(const snapshot& p_base);
+
+        /**
+         * Get the <map> node for editing, copying it on first use. Its child
+         * node list must stay undefined.
+         *
+         * @returns [sNode&] The editable <map> node.
+         */
+        sNode& root();
+
+        /** @returns [size_t] Number of top-level child nodes. */
+        size_t size() const;
+
+        /**
+         * Get a top-level child node for editing, copying its subtree on
+         * first use. Untouched children stay shared with the base snapshot.
+         *
+         * @param p_i Index of the top-level child node.
+         * @returns [sNode&] The editable child node.
+         */
+        sNode& edit(size_t p_i);
+
+        /**
+         * Appends a top-level child node.
+         *
+         * @param p_node Node to append, its memory now belongs to the...
+         * ...builder and the node is left undefined.
+         * @returns [sNode&] The appended child node.
+         */
+        sNode& add(sNode& p_node);
+
+        /** @param p_i Index of the top-level child node to remove. */
+        void remove(size_t p_i);
+
+        /** @returns [snapshot] Snapshot of the edits made so far. */
+        snapshot build() const;
+    private:
+        snapshot _snap;
+        bool _rootowned;
+        std::vector<bool> _owned; //@- Children already copied.
+    };
+
+    class readguard;
+
+    class mapstore {
+    public:
+        /** @param p_snap Snapshot to publish first. */
+        mapstore(const snapshot& p_snap);
+
+        /**
+         * Deletes every snapshot still held.
+         *
+         * !WARNING! No readguard may outlive the store.
+         */
+        ~mapstore();
+
+        mapstore(const mapstore&) = delete;
+        mapstore& operator=(const mapstore&) = delete;
+
+        /**
+         * Replaces the current snapshot. Readers already pinned keep the
+         * previous one, which is deleted once they are all done with it.
+         *
+         * @param p_snap Snapshot to publish.
+         */
+        void publish(const snapshot& p_snap);
+
+        /** @returns [snapshot] Reference counted copy of the current one. */
+        snapshot current() const;
+
+        /**
+         * Deletes replaced snapshots no reader can see anymore. Called by
+         * publish, only needed to release memory without publishing.
+         *
+         * @returns [size_t] Number of replaced snapshots still held.
+         */
+        size_t reclaim();
+    private:
+        friend class readguard;
+
+        // Reader slot, padded to a cache line to avoid false sharing.
+        struct sSlot {
+            std::atomic<bool> used;
+            std::atomic<uint64_t> epoch; //@- Pinned epoch, idle = UINT64_MAX.
+            char pad[64 - sizeof(std::atomic<uint64_t>) * 2];
+        };
+
+        // Block of reader slots, chained to the next one once all taken.
+        struct sSlots {
+            sSlot slots[TMX_SNAPSHOT_READERS];
+            std::atomic<sSlots*> next;
+
+            sSlots();
+        };
+
+        // Snapshot replaced at a given epoch.
+        struct sRetired { const snapshot* snap; uint64_t epoch; };
+
+        sSlot* pin() const;
+        void unpin(sSlot* p_slot) const;
+        size_t collect();
+
+        std::atomic<const snapshot*> _current;
+        std::atomic<uint64_t> _epoch;
+        sSlots* _slots; //@- First block of reader slots.
+        std::mutex _writer; //@- Serializes publish & reclaim.
+        std::vector<sRetired> _retired;
+    };
+
+    // Pins a mapstore's current snapshot for as long as it lives.
+    class readguard {
+    public:
+        /** @param p_store Store to read from. */
+        readguard(const mapstore& p_store);
+        ~readguard();
+
+        readguard(const readguard&) = delete;
+        readguard& operator=(const readguard&) = delete;
+
+        /** @returns [const snapshot&] The pinned snapshot. */
+        const snapshot& get() const;
+        const snapshot& operator*() const { return get(); }
+        const snapshot* operator->() const { return &get(); }
+    private:
+        const mapstore& _store;
+        mapstore::sSlot* _slot;
+        const snapshot* _snap;
+    };
+}
+
+#endif
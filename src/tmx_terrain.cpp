@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define TMX_SIMD_TERRAIN
+#endif
+
+#include "tmx_terrain.h"
+
+#define TMX_TERRAIN_NOSIG 0xFFFFFFFFu //@- Signature without terrain.
+
+/**
+ * Scrambles a value, so that neighbouring positions get unrelated picks.
+ *
+ * @param p_v The value to scramble.
+ * @returns [uint32_t] The scrambled value.
+ */
+static inline uint32_t mix(uint32_t p_v) {
+    p_v ^= p_v >> 16;
+    p_v *= 0x7FEB352Du;
+    p_v ^= p_v >> 15;
+    p_v *= 0x846CA68Bu;
+    p_v ^= p_v >> 16;
+    return p_v;
+}
+
+/**
+ * Builds the signatures of a row of tiles from the two rows of corners
+ * around it.
+ *
+ * @param p_top Corners above the tiles, p_w + 1 of them.
+ * @param p_bottom Corners below the tiles, p_w + 1 of them.
+ * @param p_w Number of tiles.
+ * @param p_out Array of at least p_w signatures to write to.
+ */
+static void rowSignatures(const uint8_t* p_top, const uint8_t* p_bottom,
+                          unsigned int p_w, uint32_t* p_out) {
+    unsigned int x = 0;
+#ifdef TMX_SIMD_TERRAIN
+    // Interleave the left & right corners, then the top & bottom pairs.
+    for (; x + 16 <= p_w; x += 16) {
+        const __m128i tl = _mm_loadu_si128((const __m128i*)(p_top + x));
+        const __m128i tr = _mm_loadu_si128((const __m128i*)(p_top + x + 1));
+        const __m128i bl = _mm_loadu_si128((const __m128i*)(p_bottom + x));
+        const __m128i br =
+            _mm_loadu_si128((const __m128i*)(p_bottom + x + 1));
+        const __m128i t0 = _mm_unpacklo_epi8(tl, tr);
+        const __m128i t1 = _mm_unpackhi_epi8(tl, tr);
+        const __m128i b0 = _mm_unpacklo_epi8(bl, br);
+        const __m128i b1 = _mm_unpackhi_epi8(bl, br);
+        __m128i* out = (__m128i*)(p_out + x);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(t0, b0));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(t0, b0));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(t1, b1));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(t1, b1));
+    }
+#endif
+    for (; x < p_w; x++)
+        p_out[x] = tmx::terrainset::signature(p_top[x], p_top[x + 1],
+                                              p_bottom[x], p_bottom[x + 1]);
+}
+
+namespace tmx {
+    terrainset::terrainset() {
+        _firstgid = 0;
+    }
+
+    terrainset::terrainset(const sTileset& p_set) {
+        _firstgid = p_set.firstgid;
+        _tilesigs.assign(p_set.count, TMX_TERRAIN_NOSIG);
+
+        // Tiles of each signature, in document order.
+        std::unordered_map<uint32_t, std::vector<uint32_t>> tiles;
+        std::vector<float> probs;
+
+        for (auto it = p_set.node ? p_set.node->nodes : nullptr; it;
+             it = it->next()) {
+            const sNode& node = *it->valptr();
+
+            if (node.tag == eTag::terrain) {
+                const sVal name = getNodeVar(node, "name");
+                const long tile = valInt(getNodeVar(node, "tile"), -1);
+                _terrains.push_back({
+                    (name.type == eType::error) ? "" : name.value,
+                    (tile < 0) ? 0 : (uint32_t)(_firstgid + tile)
+                });
+                continue;
+            }
+
+            if (node.tag != eTag::tile)
+                continue;
+            const long id = valInt(getNodeVar(node, "id"), -1);
+            const sVal terrain = getNodeVar(node, "terrain");
+            if (id < 0 || terrain.type == eType::error)
+                continue;
+
+            // "tl,tr,bl,br", empty corners have no terrain.
+            uint8_t c[4] = { TMX_TERRAIN_NONE, TMX_TERRAIN_NONE,
+                             TMX_TERRAIN_NONE, TMX_TERRAIN_NONE };
+            const char* at = terrain.value.c_str();
+            for (unsigned int i = 0; i < 4 && *at; i++) {
+                char* end;
+                const long t = std::strtol(at, &end, 10);
+                if (end != at && t >= 0 && t < TMX_TERRAIN_NONE)
+                    c[i] = t;
+                at = end;
+                while (*at && *at != ',')
+                    at++;
+                if (*at == ',')
+                    at++;
+            }
+
+            const uint32_t sig = signature(c[0], c[1], c[2], c[3]);
+            if (sig == TMX_TERRAIN_NOSIG)
+                continue;
+
+            if ((size_t)id >= _tilesigs.size())
+                _tilesigs.resize(id + 1, TMX_TERRAIN_NOSIG);
+            _tilesigs[id] = sig;
+
+            if (probs.size() <= (size_t)id)
+                probs.resize(id + 1, 0);
+            const double p = valDec(getNodeVar(node, "probability"), 1);
+            probs[id] = std::max(0.0, p);
+            tiles[sig].push_back(id);
+        }
+
+        // Flatten the tiles of each signature into one range.
+        for (auto it = tiles.begin(); it != tiles.end(); it++) {
+            const sRange r = { (uint32_t)_gids.size(),
+                               (uint32_t)it->second.size() };
+            float sum = 0;
+            for (size_t i = 0; i < it->second.size(); i++) {
+                sum += probs[it->second[i]];
+                _gids.push_back(_firstgid + it->second[i]);
+                _weights.push_back(sum);
+            }
+            _sigs[it->first] = r;
+        }
+    }
+
+    unsigned int terrainset::terrains() const {
+        return _terrains.size();
+    }
+
+    const sTerrain& terrainset::terrain(unsigned int p_terrain) const {
+        return _terrains.at(p_terrain);
+    }
+
+    unsigned int terrainset::find(str_p p_name) const {
+        for (unsigned int i = 0; i < _terrains.size(); i++)
+            if (_terrains[i].name == p_name)
+                return i;
+        return TMX_TERRAIN_NONE;
+    }
+
+    uint32_t terrainset::signature(
+        uint8_t p_tl,
+        uint8_t p_tr,
+        uint8_t p_bl,
+        uint8_t p_br
+    ) {
+        return p_tl | (p_tr << 8) | (p_bl << 16) | ((uint32_t)p_br << 24);
+    }
+
+    uint32_t terrainset::signatureOf(uint32_t p_gid) const {
+        const uint32_t id = (p_gid & TMX_GID_MASK) - _firstgid;
+        if ((p_gid & TMX_GID_MASK) < _firstgid || id >= _tilesigs.size())
+            return TMX_TERRAIN_NOSIG;
+
+        uint32_t s = _tilesigs[id];
+        uint8_t tl = s, tr = s >> 8, bl = s >> 16, br = s >> 24;
+
+        // The diagonal flip comes first, then the horizontal & vertical.
+        if (p_gid & TMX_FLIP_D)
+            std::swap(tr, bl);
+        if (p_gid & TMX_FLIP_H) {
+            std::swap(tl, tr);
+            std::swap(bl, br);
+        }
+        if (p_gid & TMX_FLIP_V) {
+            std::swap(tl, bl);
+            std::swap(tr, br);
+        }
+        return signature(tl, tr, bl, br);
+    }
+
+    const uint32_t* terrainset::candidates(uint32_t p_sig,
+                                           size_t& p_count) const {
+        auto it = _sigs.find(p_sig);
+        if (it == _sigs.end()) {
+            p_count = 0;
+            return nullptr;
+        }
+        p_count = it->second.count;
+        return &_gids[it->second.first];
+    }
+
+    uint32_t terrainset::choose(uint32_t p_sig, uint32_t p_seed) const {
+        auto it = _sigs.find(p_sig);
+        if (it == _sigs.end())
+            return 0;
+
+        const sRange& r = it->second;
+        const float total = _weights[r.first + r.count - 1];
+        if (r.count == 1 || total <= 0)
+            return _gids[r.first];
+
+        // First tile whose running sum passes the roll.
+        const float roll = (mix(p_seed) >> 8) * (total / (1 << 24));
+        const float* w = &_weights[r.first];
+        const size_t i = std::upper_bound(w, w + r.count, roll) - w;
+        return _gids[r.first + std::min<size_t>(i, r.count - 1)];
+    }
+
+    void terrainset::corners(
+        const tilelayer& p_layer,
+        std::vector<uint8_t>& p_corners
+    ) const {
+        const unsigned int w = p_layer.width(), h = p_layer.height();
+        p_corners.assign((size_t)(w + 1) * (h + 1), TMX_TERRAIN_NONE);
+
+        std::vector<uint32_t> row(w);
+        for (unsigned int y = 0; y < h; y++) {
+            p_layer.read(0, y, w, 1, row.data());
+            uint8_t* top = &p_corners[(size_t)y * (w + 1)];
+            uint8_t* bottom = top + w + 1;
+            for (unsigned int x = 0; x < w; x++) {
+                const uint32_t s = signatureOf(row[x]);
+                if (s == TMX_TERRAIN_NOSIG)
+                    continue;
+
+                const uint8_t c[4] = { (uint8_t)s, (uint8_t)(s >> 8),
+                                       (uint8_t)(s >> 16), (uint8_t)(s >> 24) };
+                uint8_t* dst[4] = { top + x, top + x + 1,
+                                    bottom + x, bottom + x + 1 };
+                for (unsigned int i = 0; i < 4; i++)
+                    if (c[i] != TMX_TERRAIN_NONE)
+                        *dst[i] = c[i];
+            }
+        }
+    }
+
+    size_t terrainset::repaint(
+        tilelayer& p_layer,
+        const std::vector<uint8_t>& p_corners,
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h,
+        uint32_t p_seed
+    ) const {
+        const unsigned int lw = p_layer.width(), lh = p_layer.height();
+        if (p_corners.size() < (size_t)(lw + 1) * (lh + 1) ||
+            p_x >= lw || p_y >= lh)
+            return 0;
+        p_w = std::min(p_w, lw - p_x);
+        p_h = std::min(p_h, lh - p_y);
+
+        size_t changed = 0;
+        std::vector<uint32_t> sigs(p_w), row(p_w);
+        for (unsigned int y = p_y; y < p_y + p_h; y++) {
+            const uint8_t* top = &p_corners[(size_t)y * (lw + 1) + p_x];
+            rowSignatures(top, top + lw + 1, p_w, sigs.data());
+            p_layer.read(p_x, y, p_w, 1, row.data());
+
+            for (unsigned int i = 0; i < p_w; i++) {
+                const uint32_t was = signatureOf(row[i]);
+
+                // Erased terrain, clear the set's tiles & keep the others.
+                if (sigs[i] == TMX_TERRAIN_NOSIG) {
+                    if (was != TMX_TERRAIN_NOSIG) {
+                        p_layer.set(p_x + i, y, 0);
+                        changed++;
+                    }
+                    continue;
+                }
+
+                // Keep tiles that already fit, so variants aren't rerolled.
+                if (was == sigs[i])
+                    continue;
+
+                const uint32_t seed = mix((p_x + i) ^ mix(y ^ mix(p_seed)));
+                const uint32_t gid = choose(sigs[i], seed);
+                if (gid != 0 && gid != row[i]) {
+                    p_layer.set(p_x + i, y, gid);
+                    changed++;
+                }
+            }
+        }
+        return changed;
+    }
+
+    size_t terrainset::paint(
+        tilelayer& p_layer,
+        std::vector<uint8_t>& p_corners,
+        unsigned int p_x,
+        unsigned int p_y,
+        unsigned int p_w,
+        unsigned int p_h,
+        uint8_t p_terrain,
+        uint32_t p_seed
+    ) const {
+        const unsigned int cw = p_layer.width() + 1;
+        const unsigned int ch = p_layer.height() + 1;
+        if (p_corners.size() < (size_t)cw * ch || p_x >= cw || p_y >= ch ||
+            p_w == 0 || p_h == 0)
+            return 0;
+        p_w = std::min(p_w, cw - p_x);
+        p_h = std::min(p_h, ch - p_y);
+
+        for (unsigned int y = p_y; y < p_y + p_h; y++)
+            std::fill_n(&p_corners[(size_t)y * cw + p_x], p_w, p_terrain);
+
+        // Every tile with a corner in the rectangle.
+        const unsigned int x0 = p_x ? p_x - 1 : 0, y0 = p_y ? p_y - 1 : 0;
+        const unsigned int x1 = std::min(p_x + p_w, cw - 1);
+        const unsigned int y1 = std::min(p_y + p_h, ch - 1);
+        if (x1 <= x0 || y1 <= y0)
+            return 0;
+        return repaint(p_layer, p_corners, x0, y0, x1 - x0, y1 - y0, p_seed);
+    }
+}
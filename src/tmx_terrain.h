@@ -0,0 +1,183 @@
+#ifndef LM_TMX_TERRAIN_H
+#define LM_TMX_TERRAIN_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "tmx_core.h"
+#include "tmx_layer.h"
+#include "tmx_tileset.h"
+
+/**============================================================================
+ * Terrain auto-tiling. The terrain corners of a tileset's tiles are indexed
+ * by their signature, so picking the tile that fits four corners is a single
+ * table lookup, and painting works on a grid of terrain corners, one per
+ * tile corner, (width + 1 by height + 1) from which the layer's tiles are
+ * repainted.
+ *
+ * A signature packs the terrain of the top-left, top-right, bottom-left &
+ * bottom-right corners into the bytes of a uint32_t, lowest byte first.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+#define TMX_TERRAIN_NONE 0xFFu //@- Corner without terrain.
+
+namespace tmx {
+    // Terrain type structure.
+    struct sTerrain {
+        std::string name;
+        uint32_t gid; //@- Gid of the tile representing the terrain, 0 if none.
+    };
+
+    class terrainset {
+    public:
+        terrainset();
+
+        /**
+         * Indexes the terrain tiles of a tileset by signature. Tiles with no
+         * terrain corners are left out.
+         *
+         * @param p_set The tileset, as returned by loadTilesets.
+         */
+        terrainset(const sTileset& p_set);
+
+        /** @returns [unsigned int] Number of terrain types. */
+        unsigned int terrains() const;
+
+        /**
+         * @param p_terrain Index of the terrain type.
+         * @returns [const sTerrain&] The terrain type.
+         */
+        const sTerrain& terrain(unsigned int p_terrain) const;
+
+        /**
+         * Finds a terrain type by name.
+         *
+         * @param p_name Name of the terrain type.
+         * @returns [unsigned int] Index of the terrain type...
+         * ...TMX_TERRAIN_NONE if none.
+         */
+        unsigned int find(str_p p_name) const;
+
+        /**
+         * Packs four terrain corners into a signature.
+         *
+         * @returns [uint32_t] The signature.
+         */
+        static uint32_t signature(
+            uint8_t p_tl,
+            uint8_t p_tr,
+            uint8_t p_bl,
+            uint8_t p_br
+        );
+
+        /**
+         * Get the signature of a tile, flip flags applied.
+         *
+         * @param p_gid Gid of the tile.
+         * @returns [uint32_t] Signature of the tile, all corners...
+         * ...TMX_TERRAIN_NONE if it's not one of the set's terrain tiles.
+         */
+        uint32_t signatureOf(uint32_t p_gid) const;
+
+        /**
+         * Get the tiles matching a signature.
+         *
+         * @param p_sig The signature.
+         * @param p_count Set to the number of tiles.
+         * @returns [const uint32_t*] Gids of the tiles, nullptr if none.
+         */
+        const uint32_t* candidates(uint32_t p_sig, size_t& p_count) const;
+
+        /**
+         * Picks one of the tiles matching a signature, weighted by their
+         * probability. The same seed always picks the same tile.
+         *
+         * @param p_sig The signature.
+         * @param p_seed Seed of the pick, ie. the tile's position hashed.
+         * @returns [uint32_t] Gid of the tile, 0 if no tile matches.
+         */
+        uint32_t choose(uint32_t p_sig, uint32_t p_seed) const;
+
+        /**
+         * Builds the terrain corner grid of a layer from its tiles. Tiles
+         * that aren't terrain tiles of the set leave their corners as they
+         * are.
+         *
+         * @param p_layer The layer's tiles.
+         * @param p_corners Corner grid to write to, resized to...
+         * ...(width + 1) * (height + 1) and filled with TMX_TERRAIN_NONE.
+         */
+        void corners(
+            const tilelayer& p_layer,
+            std::vector<uint8_t>& p_corners
+        ) const;
+
+        /**
+         * Repaints a rectangle of a layer's tiles from its corner grid, one
+         * row of signatures at a time. Tiles whose signature no tile
+         * matches are kept, tiles with no terrain on any corner are cleared
+         * to 0 if they are terrain tiles of the set.
+         *
+         * @param p_layer The layer's tiles.
+         * @param p_corners Corner grid of the layer.
+         * @param p_x Left column of the rectangle.
+         * @param p_y Top row of the rectangle.
+         * @param p_w Width of the rectangle.
+         * @param p_h Height of the rectangle.
+         * @param p_seed Seed of the tile picks. Defaults to 0.
+         * @returns [size_t] Number of tiles changed.
+         */
+        size_t repaint(
+            tilelayer& p_layer,
+            const std::vector<uint8_t>& p_corners,
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h,
+            uint32_t p_seed = 0
+        ) const;
+
+        /**
+         * Paints a rectangle of corners with a terrain, then repaints the
+         * tiles touching them, neighbours of the rectangle included.
+         *
+         * @param p_layer The layer's tiles.
+         * @param p_corners Corner grid of the layer.
+         * @param p_x Left column of the corner rectangle.
+         * @param p_y Top row of the corner rectangle.
+         * @param p_w Width of the corner rectangle.
+         * @param p_h Height of the corner rectangle.
+         * @param p_terrain Terrain to paint, TMX_TERRAIN_NONE to erase...
+         * ...the set's terrain tiles left without terrain become empty.
+         * @param p_seed Seed of the tile picks. Defaults to 0.
+         * @returns [size_t] Number of tiles changed.
+         */
+        size_t paint(
+            tilelayer& p_layer,
+            std::vector<uint8_t>& p_corners,
+            unsigned int p_x,
+            unsigned int p_y,
+            unsigned int p_w,
+            unsigned int p_h,
+            uint8_t p_terrain,
+            uint32_t p_seed = 0
+        ) const;
+    private:
+        // Tiles of a signature, in _gids & _weights.
+        struct sRange { uint32_t first; uint32_t count; };
+
+        uint32_t _firstgid;
+        std::vector<sTerrain> _terrains;
+        std::unordered_map<uint32_t, sRange> _sigs;
+        std::vector<uint32_t> _gids;
+        std::vector<float> _weights; //@- Running sum of the probabilities.
+        std::vector<uint32_t> _tilesigs; //@- Signature of each tile id.
+    };
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "tmx_tileset.h"
+#include "tmx_layer.h"
+
+namespace tmx {
+    std::vector<sTileset> loadTilesets(sNode& p_map) {
+        std::vector<sTileset> sets;
+
+        for (auto it = p_map.nodes; it; it = it->next()) {
+            sNode& n = *it->valptr();
+            if (n.tag != eTag::tileset)
+                continue;
+
+            sTileset ts;
+            ts.firstgid = valInt(getNodeVar(n, "firstgid"), 1);
+            ts.count = valInt(getNodeVar(n, "tilecount"));
+            ts.tilewidth = valInt(getNodeVar(n, "tilewidth"));
+            ts.tileheight = valInt(getNodeVar(n, "tileheight"));
+            ts.spacing = valInt(getNodeVar(n, "spacing"));
+            ts.margin = valInt(getNodeVar(n, "margin"));
+            ts.columns = valInt(getNodeVar(n, "columns"));
+            ts.offsetx = 0;
+            ts.offsety = 0;
+            ts.imagewidth = 0;
+            ts.imageheight = 0;
+            ts.node = &n;
+
+            // Pull the tileset's image and tile offset, if it has them.
+            for (auto c = n.nodes; c; c = c->next()) {
+                sNode& child = *c->valptr();
+                if (child.tag == eTag::image && ts.image.empty()) {
+                    ts.image = getNodeVar(child, "source").value;
+                    ts.imagewidth = valInt(getNodeVar(child, "width"));
+                    ts.imageheight = valInt(getNodeVar(child, "height"));
+                }
+                else if (child.tag == eTag::tileoffset) {
+                    ts.offsetx = valInt(getNodeVar(child, "x"));
+                    ts.offsety = valInt(getNodeVar(child, "y"));
+                }
+            }
+
+            // Older files leave out the column & tile counts.
+            if (ts.columns == 0 && ts.imagewidth > 0 && ts.tilewidth > 0)
+                ts.columns = (ts.imagewidth - ts.margin * 2 + ts.spacing)
+                           / (ts.tilewidth + ts.spacing);
+            if (ts.count == 0 && ts.columns > 0 && ts.tileheight > 0)
+                ts.count = ts.columns *
+                           ((ts.imageheight - ts.margin * 2 + ts.spacing)
+                           / (ts.tileheight + ts.spacing));
+
+            sets.push_back(ts);
+        }
+
+        std::sort(sets.begin(), sets.end(),
+            [](const sTileset& a, const sTileset& b) {
+                return a.firstgid < b.firstgid;
+            }
+        );
+        return sets;
+    }
+
+    const sTileset* findTileset(const std::vector<sTileset>& p_sets, uint32_t p_gid) {
+        p_gid &= TMX_GID_MASK;
+        if (p_gid == 0)
+            return nullptr;
+
+        // Last tileset whose first gid is <= p_gid.
+        auto it = std::upper_bound(p_sets.begin(), p_sets.end(), p_gid,
+            [](uint32_t gid, const sTileset& ts) { return gid < ts.firstgid; }
+        );
+        if (it == p_sets.begin())
+            return nullptr;
+        --it;
+
+        if (p_gid - it->firstgid >= it->count)
+            return nullptr;
+        return &*it;
+    }
+
+    sNode* findTile(const sTileset& p_set, uint32_t p_id) {
+        for (auto it = p_set.node->nodes; it; it = it->next()) {
+            sNode& n = *it->valptr();
+            if (n.tag != eTag::tile)
+                continue;
+            if (valInt(getNodeVar(n, "id"), -1) == (long)p_id)
+                return &n;
+        }
+        return nullptr;
+    }
+
+    uint32_t maxGid(const std::vector<sTileset>& p_sets) {
+        uint32_t m = 0;
+        for (unsigned int i = 0; i < p_sets.size(); i++)
+            if (p_sets.at(i).count > 0)
+                m = std::max(m, p_sets.at(i).firstgid + p_sets.at(i).count - 1);
+        return m;
+    }
+}
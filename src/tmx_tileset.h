@@ -0,0 +1,69 @@
+#ifndef LM_TMX_TILESET_H
+#define LM_TMX_TILESET_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tmx_core.h"
+
+/**============================================================================
+ * Flat view of a map's embedded tilesets, used to resolve gids to the
+ * tileset, image and <tile> node they belong to without walking the map.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Tileset structure.
+    struct sTileset {
+        uint32_t firstgid; //@- Gid of the tileset's first tile.
+        uint32_t count; //@- Number of tiles in the tileset.
+        unsigned int tilewidth;
+        unsigned int tileheight;
+        unsigned int spacing;
+        unsigned int margin;
+        unsigned int columns;
+        int offsetx; //@- Drawing offset of the tiles. (<tileoffset>)
+        int offsety;
+        unsigned int imagewidth; //@- 0 if the tileset has no image.
+        unsigned int imageheight;
+        std::string image; //@- Source of the tileset's image.
+        sNode* node; //@- The <tileset> node.
+    };
+
+    /**
+     * Collects the tilesets of a map, sorted by first gid. External tilesets
+     * (<tileset source="">) aren't loaded and are listed with no tiles.
+     *
+     * @param p_map The root <map> node.
+     * @returns [std::vector<sTileset>] The map's tilesets.
+     */
+    std::vector<sTileset> loadTilesets(sNode& p_map);
+
+    /**
+     * Finds the tileset a gid belongs to.
+     *
+     * @param p_sets Tilesets as returned by loadTilesets.
+     * @param p_gid Gid to look up, flip flags are ignored.
+     * @returns [const sTileset*] The gid's tileset, nullptr if none.
+     */
+    const sTileset* findTileset(const std::vector<sTileset>& p_sets, uint32_t p_gid);
+
+    /**
+     * Finds the <tile> node of a tileset's tile.
+     *
+     * @param p_set The tileset to search.
+     * @param p_id Local id of the tile. (gid - firstgid)
+     * @returns [sNode*] The tile's node, nullptr if the tile has none.
+     */
+    sNode* findTile(const sTileset& p_set, uint32_t p_id);
+
+    /**
+     * @param p_sets Tilesets as returned by loadTilesets.
+     * @returns [uint32_t] Highest gid covered by the tilesets.
+     */
+    uint32_t maxGid(const std::vector<sTileset>& p_sets);
+}
+
+#endif
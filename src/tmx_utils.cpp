@@ -1,3 +1,7 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "tmx_utils.h"
 
 /**
@@ -16,6 +20,499 @@ static char base64_value(char p_c) {
     return -1;
 }
 
+/**
+ * Check whether the given character is a decimal digit.
+ *
+ * @param p_c Character to check.
+ * @returns [bool] Whether or not the character is a digit.
+ */
+static inline bool isDigit(char p_c) {
+    return (unsigned char)(p_c - '0') < 10;
+}
+
+/**
+ * Check whether the given character can be part of a point coordinate.
+ *
+ * @param p_c Character to check.
+ * @returns [bool] Whether or not the character belongs to a number.
+ */
+static inline bool isNumChar(char p_c) {
+    return isDigit(p_c) || p_c == '-' || p_c == '+' || p_c == '.' ||
+           p_c == 'e' || p_c == 'E';
+}
+
+/**
+ * Convert a run of decimal digits to an integer one digit at a time.
+ *
+ * @param p_raw First digit.
+ * @param p_len Number of digits.
+ * @returns [uint64_t] Value of the digits.
+ */
+static inline uint64_t digitsScalar(const char* p_raw, size_t p_len) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < p_len; i++)
+        v = v * 10 + (p_raw[i] - '0');
+    return v;
+}
+
+#if defined(__SSE2__) && defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <emmintrin.h>
+#define TMX_SIMD_PARSE
+
+/**
+ * Convert up to 8 decimal digits to an integer within a 64-bit word. The
+ * digits are shifted to the top of the word and left-padded with '0' so all
+ * eight lanes are combined with three multiplies. 8 bytes must be readable.
+ *
+ * @param p_raw First digit.
+ * @param p_len Number of digits, 1 to 8.
+ * @returns [uint32_t] Value of the digits.
+ */
+static inline uint32_t digitsSWAR(const char* p_raw, size_t p_len) {
+    uint64_t v;
+    memcpy(&v, p_raw, 8);
+
+    v <<= 8 * (8 - p_len);
+    if (p_len < 8)
+        v |= 0x3030303030303030ULL >> (8 * p_len);
+
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return (uint32_t)v;
+}
+
+/**
+ * Convert a run of decimal digits to an integer, eight digits at a time.
+ *
+ * @param p_raw First digit.
+ * @param p_len Number of digits.
+ * @param p_end End of the readable buffer.
+ * @returns [uint64_t] Value of the digits.
+ */
+static inline uint64_t digits(const char* p_raw, size_t p_len, const char* p_end) {
+    if (p_len == 0 || p_len > 16 || p_raw + 8 > p_end)
+        return digitsScalar(p_raw, p_len);
+    if (p_len <= 8)
+        return digitsSWAR(p_raw, p_len);
+    return (uint64_t)digitsSWAR(p_raw, p_len - 8) * 100000000ULL +
+           digitsSWAR(p_raw + p_len - 8, 8);
+}
+
+/**
+ * Mask of the bytes in a 16 byte block that are decimal digits.
+ *
+ * @param p_raw Start of the block.
+ * @returns [unsigned int] One bit per byte, set for digits.
+ */
+static inline unsigned int digitMask(const char* p_raw) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p_raw);
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d));
+}
+
+/**
+ * Mask of the bytes in a 16 byte block that can be part of a coordinate.
+ *
+ * @param p_raw Start of the block.
+ * @returns [unsigned int] One bit per byte, set for number characters.
+ */
+static inline unsigned int numMask(const char* p_raw) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p_raw);
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('-')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))
+        ),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+            _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                           _mm_set1_epi8('e'))
+        )
+    );
+    return digitMask(p_raw) | _mm_movemask_epi8(m);
+}
+#else
+static inline uint64_t digits(const char* p_raw, size_t p_len, const char*) {
+    return digitsScalar(p_raw, p_len);
+}
+#endif
+
+/**
+ * Parse one coordinate token. ([+-]digits[.digits])
+ *
+ * @param p_raw First character of the token.
+ * @param p_len Length of the token.
+ * @param p_end End of the readable buffer.
+ * @returns [float] Value of the token.
+ */
+static float parseCoord(const char* p_raw, size_t p_len, const char* p_end) {
+    size_t i = 0;
+    bool neg = false;
+    if (p_raw[0] == '-' || p_raw[0] == '+') {
+        neg = (p_raw[0] == '-');
+        i++;
+    }
+
+    size_t il = 0;
+    while (i + il < p_len && isDigit(p_raw[i + il]))
+        il++;
+
+    size_t pos = i + il;
+    size_t fl = 0;
+    if (pos < p_len && p_raw[pos] == '.') {
+        pos++;
+        while (pos + fl < p_len && isDigit(p_raw[pos + fl]))
+            fl++;
+    }
+
+    // Anything else (exponents, stray signs) goes through the C library.
+    if (pos + fl != p_len || il > 16 || fl > 16) {
+        std::string token(p_raw, p_len);
+        return strtof(token.c_str(), nullptr);
+    }
+
+    static const double pow10[17] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+        1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16
+    };
+
+    double v = (double)digits(p_raw + i, il, p_end);
+    if (fl > 0)
+        v += (double)digits(p_raw + pos, fl, p_end) / pow10[fl];
+    return (float)(neg ? -v : v);
+}
+
+// Bit reader over a deflate stream, least significant bit first.
+struct sBits {
+    const uint8_t* in;
+    size_t len;
+    size_t pos;
+    size_t over; //@- Bytes read past the end of the stream, as zeros.
+    uint64_t buf;
+    unsigned int cnt;
+};
+
+/** Tops the bit buffer up to at least 56 bits. */
+static inline void refill(sBits& p_b) {
+    while (p_b.cnt <= 56) {
+        if (p_b.pos < p_b.len)
+            p_b.buf |= (uint64_t)p_b.in[p_b.pos++] << p_b.cnt;
+        else
+            p_b.over++;
+        p_b.cnt += 8;
+    }
+}
+
+/**
+ * Read bits from a deflate stream.
+ *
+ * @param p_b The bit reader.
+ * @param p_n Number of bits to read, up to 32.
+ * @returns [uint32_t] The bits.
+ */
+static inline uint32_t bits(sBits& p_b, unsigned int p_n) {
+    if (p_b.cnt < p_n)
+        refill(p_b);
+    const uint32_t v = (uint32_t)(p_b.buf & ((1ull << p_n) - 1));
+    p_b.buf >>= p_n;
+    p_b.cnt -= p_n;
+    return v;
+}
+
+// Canonical Huffman code of a deflate block, with a lookup table for the
+// codes of up to 9 bits. (fast = symbol << 4 | length, 0 = longer code)
+struct sHuff {
+    uint16_t count[16]; //@- Number of codes of each length.
+    uint16_t symbol[288]; //@- Symbols ordered by code.
+    uint16_t fast[512];
+};
+
+/**
+ * Builds a Huffman code from its code lengths.
+ *
+ * @param p_h Code to build.
+ * @param p_lens Code length of each symbol, 0 = unused.
+ * @param p_n Number of symbols.
+ * @returns [bool] False if the lengths are over-subscribed.
+ */
+static bool huffBuild(sHuff& p_h, const uint8_t* p_lens, unsigned int p_n) {
+    memset(p_h.count, 0, sizeof(p_h.count));
+    memset(p_h.fast, 0, sizeof(p_h.fast));
+    for (unsigned int i = 0; i < p_n; i++)
+        p_h.count[p_lens[i]]++;
+    p_h.count[0] = 0;
+
+    int left = 1;
+    for (unsigned int l = 1; l < 16; l++) {
+        left = (left << 1) - p_h.count[l];
+        if (left < 0)
+            return false;
+    }
+
+    uint16_t offs[16];
+    uint16_t code[16];
+    offs[1] = 0;
+    code[1] = 0;
+    for (unsigned int l = 1; l < 15; l++) {
+        offs[l + 1] = offs[l] + p_h.count[l];
+        code[l + 1] = (code[l] + p_h.count[l]) << 1;
+    }
+
+    for (unsigned int i = 0; i < p_n; i++) {
+        const unsigned int l = p_lens[i];
+        if (l == 0)
+            continue;
+        p_h.symbol[offs[l]++] = i;
+
+        // Codes are read reversed, fill every entry they prefix.
+        const unsigned int c = code[l]++;
+        if (l > 9)
+            continue;
+        unsigned int r = 0;
+        for (unsigned int b = 0; b < l; b++)
+            r |= ((c >> b) & 1) << (l - 1 - b);
+        for (unsigned int k = r; k < 512; k += 1u << l)
+            p_h.fast[k] = (uint16_t)((i << 4) | l);
+    }
+    return true;
+}
+
+/**
+ * Decode one symbol from a deflate stream.
+ *
+ * @param p_b The bit reader.
+ * @param p_h The code to decode with.
+ * @returns [int] The symbol, -1 if the code isn't in the table.
+ */
+static inline int huffDecode(sBits& p_b, const sHuff& p_h) {
+    if (p_b.cnt < 15)
+        refill(p_b);
+    const uint16_t e = p_h.fast[p_b.buf & 511];
+    if (e != 0) {
+        p_b.buf >>= e & 15;
+        p_b.cnt -= e & 15;
+        return e >> 4;
+    }
+
+    // Longer codes, one bit at a time.
+    int code = 0, first = 0, index = 0;
+    for (unsigned int l = 1; l < 16; l++) {
+        code |= bits(p_b, 1);
+        const int n = p_h.count[l];
+        if (code - n < first)
+            return p_h.symbol[index + (code - first)];
+        index += n;
+        first = (first + n) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+/**
+ * Decompress a raw deflate stream. (RFC 1951)
+ *
+ * @param p_b Bit reader positioned at the start of the stream.
+ * @param p_out Buffer to decompress into.
+ * @param p_max Size of the buffer.
+ * @returns [size_t] Bytes written, SIZE_MAX if the stream is corrupt or...
+ * ...doesn't fit the buffer.
+ */
+static size_t inflateRaw(sBits& p_b, uint8_t* p_out, size_t p_max) {
+    static const uint16_t lbase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    static const uint8_t lext[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    static const uint16_t dbase[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+        385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+        16385, 24577
+    };
+    static const uint8_t dext[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    static const uint8_t order[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+
+    size_t n = 0;
+    sHuff lit, dist;
+    uint8_t lens[320];
+    unsigned int last;
+
+    do {
+        last = bits(p_b, 1);
+        const unsigned int type = bits(p_b, 2);
+
+        if (type == 0) {
+            // Stored block, byte aligned.
+            bits(p_b, p_b.cnt & 7);
+            const uint32_t len = bits(p_b, 16);
+            if ((bits(p_b, 16) ^ 0xFFFF) != len || p_max - n < len)
+                return SIZE_MAX;
+            for (uint32_t i = 0; i < len; i++)
+                p_out[n++] = (uint8_t)bits(p_b, 8);
+            continue;
+        }
+
+        if (type == 1) {
+            // Fixed codes.
+            for (unsigned int i = 0; i < 288; i++)
+                lens[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+            huffBuild(lit, lens, 288);
+            for (unsigned int i = 0; i < 30; i++)
+                lens[i] = 5;
+            huffBuild(dist, lens, 30);
+        }
+        else if (type == 2) {
+            // Dynamic codes, themselves Huffman coded.
+            const unsigned int nlen = bits(p_b, 5) + 257;
+            const unsigned int ndist = bits(p_b, 5) + 1;
+            const unsigned int ncode = bits(p_b, 4) + 4;
+            if (nlen > 286 || ndist > 30)
+                return SIZE_MAX;
+
+            memset(lens, 0, 19);
+            for (unsigned int i = 0; i < ncode; i++)
+                lens[order[i]] = (uint8_t)bits(p_b, 3);
+            sHuff lencode;
+            if (!huffBuild(lencode, lens, 19))
+                return SIZE_MAX;
+
+            for (unsigned int i = 0; i < nlen + ndist;) {
+                const int sym = huffDecode(p_b, lencode);
+                if (sym < 0)
+                    return SIZE_MAX;
+                if (sym < 16) {
+                    lens[i++] = (uint8_t)sym;
+                    continue;
+                }
+
+                uint8_t len = 0;
+                unsigned int rep;
+                if (sym == 16) {
+                    if (i == 0)
+                        return SIZE_MAX;
+                    len = lens[i - 1];
+                    rep = 3 + bits(p_b, 2);
+                }
+                else if (sym == 17)
+                    rep = 3 + bits(p_b, 3);
+                else
+                    rep = 11 + bits(p_b, 7);
+                if (i + rep > nlen + ndist)
+                    return SIZE_MAX;
+                while (rep--)
+                    lens[i++] = len;
+            }
+
+            if (lens[256] == 0 || !huffBuild(lit, lens, nlen) ||
+                !huffBuild(dist, lens + nlen, ndist))
+                return SIZE_MAX;
+        }
+        else
+            return SIZE_MAX;
+
+        // Literals & back references up to the end of block symbol.
+        for (;;) {
+            int sym = huffDecode(p_b, lit);
+            if (sym < 0 || p_b.over > 8)
+                return SIZE_MAX;
+            if (sym < 256) {
+                if (n == p_max)
+                    return SIZE_MAX;
+                p_out[n++] = (uint8_t)sym;
+                continue;
+            }
+            if (sym == 256)
+                break;
+
+            sym -= 257;
+            if (sym >= 29)
+                return SIZE_MAX;
+            const size_t len = lbase[sym] + bits(p_b, lext[sym]);
+            const int d = huffDecode(p_b, dist);
+            if (d < 0 || d >= 30)
+                return SIZE_MAX;
+            const size_t back = dbase[d] + bits(p_b, dext[d]);
+            if (back > n || p_max - n < len)
+                return SIZE_MAX;
+
+            // Overlapping copies repeat the last bytes, go byte by byte.
+            const uint8_t* from = p_out + n - back;
+            for (size_t i = 0; i < len; i++)
+                p_out[n + i] = from[i];
+            n += len;
+        }
+    } while (!last);
+
+    // Reading past the end means the stream was cut short.
+    if (p_b.over * 8 > p_b.cnt)
+        return SIZE_MAX;
+    return n;
+}
+
+/**
+ * Skip to the next byte of a deflate stream once it has been decoded.
+ *
+ * @param p_b The bit reader.
+ * @returns [size_t] Offset of the next byte in the stream.
+ */
+static inline size_t bytePos(const sBits& p_b) {
+    return p_b.pos + p_b.over - p_b.cnt / 8;
+}
+
+/** @returns [uint32_t] Little-endian 32-bit value at the given address. */
+static inline uint32_t le32(const uint8_t* p_at) {
+    return p_at[0] | (p_at[1] << 8) | (p_at[2] << 16) |
+           ((uint32_t)p_at[3] << 24);
+}
+
+/** @returns [uint32_t] Adler-32 checksum of the data. (zlib) */
+static uint32_t adler32(const uint8_t* p_data, size_t p_len) {
+    uint32_t a = 1, b = 0;
+    while (p_len > 0) {
+        // Largest run that can't overflow before the modulo.
+        const size_t n = (p_len < 5552) ? p_len : 5552;
+        for (size_t i = 0; i < n; i++) {
+            a += p_data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        p_data += n;
+        p_len -= n;
+    }
+    return (b << 16) | a;
+}
+
+/** @returns [uint32_t] CRC-32 checksum of the data. (gzip) */
+static uint32_t crc32(const uint8_t* p_data, size_t p_len) {
+    static uint32_t table[256];
+    static const bool ready = []() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (unsigned int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < p_len; i++)
+        c = table[(c ^ p_data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
 namespace tmx {
     std::string base64_decode(const char* p_raw, const size_t p_len) {
         // Read 4 base64 chars, write 3 bytes.
@@ -39,4 +536,216 @@ namespace tmx {
         }
         return std::string(buff);
     }
+
+    size_t parseGids(
+        const char* p_raw,
+        const size_t p_len,
+        uint32_t* p_out,
+        const size_t p_max
+    ) {
+        const char* end = p_raw + p_len;
+        size_t n = 0;
+        size_t i = 0;
+
+#ifdef TMX_SIMD_PARSE
+        // Find the numbers 16 bytes at a time and convert each one whole.
+        while (i + 16 <= p_len && n < p_max) {
+            unsigned int m = digitMask(p_raw + i);
+            unsigned int next = 16;
+
+            while (m != 0 && n < p_max) {
+                const unsigned int s = __builtin_ctz(m);
+                const unsigned int l = __builtin_ctz(~(m >> s));
+
+                // The number may continue into the next block.
+                if (s + l == 16 && s != 0) {
+                    next = s;
+                    break;
+                }
+
+                size_t len = l;
+                while (i + s + len < p_len && isDigit(p_raw[i + s + len]))
+                    len++;
+                p_out[n++] = (uint32_t)digits(p_raw + i + s, len, end);
+
+                if (s + len >= 16) {
+                    next = s + len;
+                    break;
+                }
+                m &= ~(((1u << l) - 1) << s);
+            }
+            i += next;
+        }
+#endif
+
+        while (i < p_len && n < p_max) {
+            // Skip the separators up to the next number.
+            if (!isDigit(p_raw[i])) {
+                i++;
+                continue;
+            }
+
+            size_t len = 0;
+            while (i + len < p_len && isDigit(p_raw[i + len]))
+                len++;
+            p_out[n++] = (uint32_t)digits(p_raw + i, len, end);
+            i += len;
+        }
+        return n;
+    }
+
+    size_t parsePoints(
+        const char* p_raw,
+        const size_t p_len,
+        float* p_out,
+        const size_t p_max
+    ) {
+        const char* end = p_raw + p_len;
+        size_t n = 0;
+        size_t i = 0;
+
+#ifdef TMX_SIMD_PARSE
+        // Find the coordinate tokens 16 bytes at a time.
+        while (i + 16 <= p_len && n < p_max) {
+            unsigned int m = numMask(p_raw + i);
+            unsigned int next = 16;
+
+            while (m != 0 && n < p_max) {
+                const unsigned int s = __builtin_ctz(m);
+                const unsigned int l = __builtin_ctz(~(m >> s));
+
+                // The token may continue into the next block.
+                if (s + l == 16 && s != 0) {
+                    next = s;
+                    break;
+                }
+
+                size_t len = l;
+                while (i + s + len < p_len && isNumChar(p_raw[i + s + len]))
+                    len++;
+                p_out[n++] = parseCoord(p_raw + i + s, len, end);
+
+                if (s + len >= 16) {
+                    next = s + len;
+                    break;
+                }
+                m &= ~(((1u << l) - 1) << s);
+            }
+            i += next;
+        }
+#endif
+
+        while (i < p_len && n < p_max) {
+            // Skip the separators up to the next coordinate.
+            if (!isNumChar(p_raw[i])) {
+                i++;
+                continue;
+            }
+
+            size_t len = 0;
+            while (i + len < p_len && isNumChar(p_raw[i + len]))
+                len++;
+            p_out[n++] = parseCoord(p_raw + i, len, end);
+            i += len;
+        }
+        return n;
+    }
+
+    void parallelFor(
+        size_t p_count,
+        const std::function<void(size_t)>& p_fn,
+        unsigned int p_threads
+    ) {
+        if (p_threads == 0)
+            p_threads = std::thread::hardware_concurrency();
+        if (p_threads == 0)
+            p_threads = 1;
+        if (p_threads > p_count)
+            p_threads = (unsigned int)p_count;
+
+        // Not worth spawning threads for.
+        if (p_threads <= 1) {
+            for (size_t i = 0; i < p_count; i++)
+                p_fn(i);
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t i = next++; i < p_count; i = next++)
+                p_fn(i);
+        };
+
+        // The calling thread works alongside the spawned ones.
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < p_threads; t++)
+            threads.push_back(std::thread(work));
+        work();
+        for (unsigned int t = 0; t < threads.size(); t++)
+            threads.at(t).join();
+    }
+
+    size_t zlib_decompress(
+        const char* p_raw,
+        const size_t p_len,
+        char* p_out,
+        const size_t p_max
+    ) {
+        const uint8_t* in = (const uint8_t*)p_raw;
+        // Deflate, no preset dictionary, header checksum.
+        if (p_len < 6 || (in[0] & 0x0F) != 8 || (in[1] & 0x20) != 0 ||
+            ((in[0] << 8) | in[1]) % 31 != 0)
+            return 0;
+
+        sBits b = { in + 2, p_len - 2, 0, 0, 0, 0 };
+        const size_t n = inflateRaw(b, (uint8_t*)p_out, p_max);
+        const size_t end = 2 + bytePos(b);
+        if (n == SIZE_MAX || end + 4 > p_len)
+            return 0;
+
+        // The checksum is stored big-endian.
+        const uint32_t sum = __builtin_bswap32(le32(in + end));
+        return (adler32((const uint8_t*)p_out, n) == sum) ? n : 0;
+    }
+
+    size_t gzip_decompress(
+        const char* p_raw,
+        const size_t p_len,
+        char* p_out,
+        const size_t p_max
+    ) {
+        const uint8_t* in = (const uint8_t*)p_raw;
+        if (p_len < 18 || in[0] != 0x1F || in[1] != 0x8B || in[2] != 8)
+            return 0;
+
+        // Skip the optional header fields.
+        const uint8_t flags = in[3];
+        size_t at = 10;
+        if (flags & 4) {
+            if (at + 2 > p_len)
+                return 0;
+            at += 2 + (in[at] | (in[at + 1] << 8));
+        }
+        for (uint8_t f = 8; f <= 16; f <<= 1)
+            if (flags & f) {
+                while (at < p_len && in[at] != 0)
+                    at++;
+                at++;
+            }
+        if (flags & 2)
+            at += 2;
+        if (at >= p_len)
+            return 0;
+
+        sBits b = { in + at, p_len - at, 0, 0, 0, 0 };
+        const size_t n = inflateRaw(b, (uint8_t*)p_out, p_max);
+        const size_t end = at + bytePos(b);
+        if (n == SIZE_MAX || end + 8 > p_len)
+            return 0;
+
+        if (le32(in + end + 4) != (uint32_t)n ||
+            le32(in + end) != crc32((const uint8_t*)p_out, n))
+            return 0;
+        return n;
+    }
 }
@@ -2,9 +2,11 @@
 #define LM_TMX_UTILS_H
 
 #include <iostream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <cstring>
 #include <string>
+#include <functional>
 
 #include "tlist.hpp"
 
@@ -19,9 +21,88 @@ namespace tmx {
     std::string base64_decode(const char* p_raw, const size_t p_len);
 
     /**
-     * @todo zlib decompress
-     * @todo gzip decompress
+     * Parse a comma/whitespace separated list of unsigned gids. Numbers are
+     * located 16 bytes at a time and converted 8 digits at a time where the
+     * target supports it. (SSE2, little-endian)
+     *
+     * @param p_raw C-string holding the list to parse.
+     * @param p_len Length of the C-string holding the list to parse.
+     * @param p_out Array to write the gids to.
+     * @param p_max Maximum number of gids to write.
+     * @returns [size_t] Number of gids written.
+     */
+    size_t parseGids(
+        const char* p_raw,
+        const size_t p_len,
+        uint32_t* p_out,
+        const size_t p_max
+    );
+
+    /**
+     * Parse a list of points ("x,y x,y ...") into a flat array of floats.
+     * Coordinates are located and converted like in parseGids, those with
+     * exponents fall back to strtof.
+     *
+     * @param p_raw C-string holding the points to parse.
+     * @param p_len Length of the C-string holding the points to parse.
+     * @param p_out Array to write the coordinates to. (x0, y0, x1, y1...)
+     * @param p_max Maximum number of coordinates to write.
+     * @returns [size_t] Number of coordinates written.
+     */
+    size_t parsePoints(
+        const char* p_raw,
+        const size_t p_len,
+        float* p_out,
+        const size_t p_max
+    );
+
+    /**
+     * Run a function over a range of indices on several threads. Each
+     * thread takes the next unclaimed index until the range is exhausted.
+     *
+     * @param p_count Number of indices. (0 to p_count - 1)
+     * @param p_fn Function to call with each index.
+     * @param p_threads Maximum number of threads, defaults to one per core.
+     */
+    void parallelFor(
+        size_t p_count,
+        const std::function<void(size_t)>& p_fn,
+        unsigned int p_threads = 0
+    );
+
+    /**
+     * Decompress a zlib stream. (RFC 1950)
+     *
+     * @param p_raw The compressed stream.
+     * @param p_len Length of the compressed stream.
+     * @param p_out Buffer to decompress into.
+     * @param p_max Size of the buffer.
+     * @returns [size_t] Bytes written, 0 if the stream is corrupt or...
+     * ...doesn't fit the buffer.
+     */
+    size_t zlib_decompress(
+        const char* p_raw,
+        const size_t p_len,
+        char* p_out,
+        const size_t p_max
+    );
+
+    /**
+     * Decompress the first member of a gzip stream. (RFC 1952)
+     *
+     * @param p_raw The compressed stream.
+     * @param p_len Length of the compressed stream.
+     * @param p_out Buffer to decompress into.
+     * @param p_max Size of the buffer.
+     * @returns [size_t] Bytes written, 0 if the stream is corrupt or...
+     * ...doesn't fit the buffer.
      */
+    size_t gzip_decompress(
+        const char* p_raw,
+        const size_t p_len,
+        char* p_out,
+        const size_t p_max
+    );
 }
 
 #endif
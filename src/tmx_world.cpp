@@ -0,0 +1,220 @@
+#include <cmath>
+#include <algorithm>
+
+#include "tmx_world.h"
+
+namespace tmx {
+    world::world(
+        const worldresolver& p_paths,
+        float p_cellwidth,
+        float p_cellheight,
+        size_t p_budget,
+        const sAsyncOpts& p_opts
+    ) {
+        _paths = p_paths;
+        _cellwidth = p_cellwidth;
+        _cellheight = p_cellheight;
+        _budget = p_budget;
+        _opts = p_opts;
+        _tick = 0;
+        _stats = sWorldStats();
+        _latencysum = 0;
+    }
+
+    world::~world() {
+        for (auto it = _entries.begin(); it != _entries.end(); ++it)
+            if (!it->second.ready)
+                it->second.handle.cancel();
+
+        for (auto it = _entries.begin(); it != _entries.end(); ++it)
+            _cancelled.push_back(it->second);
+        _entries.clear();
+
+        for (unsigned int i = 0; i < _cancelled.size(); i++) {
+            sEntry& e = _cancelled.at(i);
+            if (!e.ready) {
+                try {
+                    e.map = e.handle.get();
+                } catch (...) {
+                    continue;
+                }
+            }
+            freeNode(e.map);
+        }
+    }
+
+    void world::update(float p_x, float p_y, float p_radius) {
+        _tick++;
+        for (auto it = _entries.begin(); it != _entries.end(); ++it)
+            it->second.wanted = false;
+
+        // Request every cell whose rectangle touches the circle.
+        const int x0 = (int)std::floor((p_x - p_radius) / _cellwidth);
+        const int x1 = (int)std::floor((p_x + p_radius) / _cellwidth);
+        const int y0 = (int)std::floor((p_y - p_radius) / _cellheight);
+        const int y1 = (int)std::floor((p_y + p_radius) / _cellheight);
+
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++) {
+                const float nx = std::max(cx * _cellwidth,
+                                 std::min(p_x, (cx + 1) * _cellwidth));
+                const float ny = std::max(cy * _cellheight,
+                                 std::min(p_y, (cy + 1) * _cellheight));
+                if ((nx - p_x) * (nx - p_x) + (ny - p_y) * (ny - p_y) >
+                    p_radius * p_radius)
+                    continue;
+
+                auto it = _entries.find(cellkey(cx, cy));
+                if (it == _entries.end()) {
+                    request(cx, cy, true);
+                    it = _entries.find(cellkey(cx, cy));
+                    if (it == _entries.end())
+                        continue;
+                }
+                it->second.wanted = true;
+                it->second.lastuse = _tick;
+            }
+
+        // Prefetches that left the radius before finishing are not worth
+        // the memory, drop them and free the result once the thread is done.
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            const sEntry& e = it->second;
+            if (!e.ready && !e.wanted && e.prefetch) {
+                it->second.handle.cancel();
+                _cancelled.push_back(it->second);
+                it = _entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        collect();
+        evict();
+    }
+
+    sNode* world::get(int p_cx, int p_cy) {
+        auto it = _entries.find(cellkey(p_cx, p_cy));
+        if (it != _entries.end() && it->second.ready) {
+            _stats.hits++;
+            it->second.lastuse = _tick;
+            return &it->second.map;
+        }
+
+        _stats.misses++;
+        if (it == _entries.end())
+            request(p_cx, p_cy, false);
+        return nullptr;
+    }
+
+    void world::setBudget(size_t p_budget) {
+        _budget = p_budget;
+        evict();
+    }
+
+    sWorldStats world::stats() const {
+        sWorldStats stats = _stats;
+        stats.latencyavg = stats.loads ? _latencysum / stats.loads : 0;
+        stats.resident = 0;
+        stats.pending = 0;
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->second.ready)
+                stats.resident++;
+            else
+                stats.pending++;
+        }
+        return stats;
+    }
+
+    void world::request(int p_cx, int p_cy, bool p_prefetch) {
+        const std::string path = _paths(p_cx, p_cy);
+        if (path.empty())
+            return;
+
+        sEntry e;
+        e.map = mkNode(eTag::ignore);
+        e.ready = false;
+        e.wanted = false;
+        e.prefetch = p_prefetch;
+        e.bytes = 0;
+        e.lastuse = _tick;
+        e.requested = clock::now();
+        e.took = std::make_shared<std::atomic<long long>>(-1);
+        e.handle = loadAsync(path, _opts);
+
+        // Time the load on its own thread, so the latency does not depend
+        // on how often update() polls.
+        const clock::time_point start = e.requested;
+        std::shared_ptr<std::atomic<long long>> took = e.took;
+        e.handle.then([start, took]() {
+            took->store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - start).count());
+        });
+
+        _entries[cellkey(p_cx, p_cy)] = e;
+    }
+
+    void world::collect() {
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            sEntry& e = it->second;
+            if (e.ready || !e.handle.ready())
+                continue;
+
+            try {
+                e.map = e.handle.get();
+            } catch (...) {
+                // Missing or broken map, keep an empty cell so it is not
+                // requested again every update.
+                e.map = mkNode(eTag::ignore);
+            }
+            e.ready = true;
+            e.bytes = nodeMemory(e.map);
+            _stats.bytes += e.bytes;
+            _stats.loads++;
+
+            long long took = e.took->load();
+            if (took < 0) {
+                took = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - e.requested).count();
+            }
+            const double ms = took / 1e6;
+            _latencysum += ms;
+            _stats.latencymax = std::max(_stats.latencymax, ms);
+        }
+
+        for (unsigned int i = 0; i < _cancelled.size();) {
+            sEntry& e = _cancelled.at(i);
+            if (!e.handle.ready()) {
+                i++;
+                continue;
+            }
+            try {
+                sNode map = e.handle.get();
+                freeNode(map);
+            } catch (...) {}
+            _cancelled.at(i) = _cancelled.back();
+            _cancelled.pop_back();
+        }
+    }
+
+    void world::evict() {
+        while (_stats.bytes > _budget) {
+            auto lru = _entries.end();
+            for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+                const sEntry& e = it->second;
+                if (!e.ready || e.wanted)
+                    continue;
+                if (lru == _entries.end() || e.lastuse < lru->second.lastuse)
+                    lru = it;
+            }
+
+            // Everything left is within the radius, stay over budget.
+            if (lru == _entries.end())
+                break;
+
+            _stats.bytes -= lru->second.bytes;
+            _stats.evictions++;
+            freeNode(lru->second.map);
+            _entries.erase(lru);
+        }
+    }
+}
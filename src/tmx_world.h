@@ -0,0 +1,123 @@
+#ifndef LM_TMX_WORLD_H
+#define LM_TMX_WORLD_H
+
+#include <map>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+#include "tmx_core.h"
+#include "tmx_async.h"
+
+/**============================================================================
+ * Streaming of a world made of TMX maps laid out on a grid. Maps around the
+ * player are loaded in the background ahead of time and the least recently
+ * used ones are freed once the world goes over its memory budget.
+ *
+ * @author Zaid
+ * @version 1.0
+ ============================================================================*/
+
+namespace tmx {
+    // Maps a world grid cell to the path of its map. ("" = no map)
+    typedef std::function<std::string(int, int)> worldresolver;
+
+    // World streaming statistics.
+    struct sWorldStats {
+        uint64_t hits; //@- get() calls answered with a loaded map.
+        uint64_t misses; //@- get() calls for maps not loaded yet.
+        uint64_t loads; //@- Maps loaded.
+        uint64_t evictions; //@- Maps freed to stay within budget.
+        double latencyavg; //@- Average load time in milliseconds.
+        double latencymax; //@- Longest load time in milliseconds.
+        size_t bytes; //@- Estimated memory of the loaded maps.
+        unsigned int resident; //@- Maps loaded.
+        unsigned int pending; //@- Maps being loaded.
+    };
+
+    class world {
+    public:
+        /**
+         * @param p_paths Resolves grid cells to map paths.
+         * @param p_cellwidth Width of a grid cell in world units.
+         * @param p_cellheight Height of a grid cell in world units.
+         * @param p_budget Memory budget in bytes for the loaded maps.
+         * @param p_opts Options for the background loads.
+         */
+        world(
+            const worldresolver& p_paths,
+            float p_cellwidth,
+            float p_cellheight,
+            size_t p_budget,
+            const sAsyncOpts& p_opts = sAsyncOpts()
+        );
+
+        /** Cancels pending loads, waits for them and frees all maps. */
+        ~world();
+
+        /**
+         * Prefetches the maps of all cells within the radius around a
+         * position, collects finished loads and evicts maps over budget.
+         * Maps within the radius are never evicted, prefetches that left
+         * it before finishing are cancelled.
+         *
+         * @param p_x World x position of the player.
+         * @param p_y World y position of the player.
+         * @param p_radius Prefetch radius in world units.
+         */
+        void update(float p_x, float p_y, float p_radius);
+
+        /**
+         * Get the map of a grid cell, starting its load on a miss.
+         *
+         * @param p_cx Grid column.
+         * @param p_cy Grid row.
+         * @returns [sNode*] The cell's map, nullptr if not loaded yet. Valid...
+         * ...until the map is evicted by a later update().
+         */
+        sNode* get(int p_cx, int p_cy);
+
+        /** @param p_budget New memory budget in bytes. */
+        void setBudget(size_t p_budget);
+
+        /** @returns [sWorldStats] Current streaming statistics. */
+        sWorldStats stats() const;
+    private:
+        typedef std::chrono::steady_clock clock;
+        typedef std::pair<int, int> cellkey;
+
+        // Map of one grid cell.
+        struct sEntry {
+            loadhandle handle;
+            sNode map;
+            bool ready;
+            bool wanted; //@- Within the radius of the last update.
+            bool prefetch; //@- Requested by update() rather than get().
+            size_t bytes;
+            uint64_t lastuse; //@- Tick of the last use, for LRU eviction.
+            clock::time_point requested;
+            //@- Nanoseconds from request to completion, -1 until done.
+            std::shared_ptr<std::atomic<long long>> took;
+        };
+
+        void request(int p_cx, int p_cy, bool p_prefetch);
+        void collect();
+        void evict();
+
+        worldresolver _paths;
+        float _cellwidth;
+        float _cellheight;
+        size_t _budget;
+        sAsyncOpts _opts;
+
+        std::map<cellkey, sEntry> _entries;
+        std::vector<sEntry> _cancelled; //@- Loads dropped before finishing.
+        uint64_t _tick;
+        sWorldStats _stats;
+        double _latencysum;
+    };
+}
+
+#endif